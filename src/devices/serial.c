@@ -37,6 +37,13 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled (both bits set). */
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -47,10 +54,24 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_TEMT 0x40           /* Transmitter Empty: THR and shifter. */
 
+/* Base rate of 16550A, in Hz, and the fastest data rate. */
+#define BASE_RATE (1843200 / 16)
+
+/* Size of the 16550A transmit FIFO, in bytes. */
+#define FIFO_SIZE 16
+
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
+/* Data rate, in bits per second. */
+static int serial_bps = BASE_RATE;
+
+/* Bytes we may write to THR at once when it is empty: FIFO_SIZE
+   if the UART's FIFOs are working, otherwise 1. */
+static int xmit_burst = 1;
+
 /* Data to be transmitted. */
 static struct intq txq;
 
@@ -69,7 +90,7 @@ init_poll (void)
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
   outb (FCR_REG, 0);                    /* Disable FIFO. */
-  set_serial (9600);                    /* 9.6 kbps, N-8-1. */
+  set_serial (serial_bps);              /* N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
   mode = POLL;
@@ -90,6 +111,16 @@ serial_init_queue (void)
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
+
+  /* Turn on the FIFOs, if the UART has them, so that each
+     transmit interrupt can send a burst of bytes instead of
+     just one.  The receive trigger level stays at 1 byte. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    xmit_burst = FIFO_SIZE;
+  else
+    outb (FCR_REG, 0);
+
   write_ier ();
   intr_set_level (old_level);
 }
@@ -152,14 +183,41 @@ serial_notify (void)
     write_ier ();
 }
 
+/* Sets the serial port's data rate to BPS bits per second,
+   which must be at least 300 and evenly divide 115,200.  May be
+   called before serial_init_queue(), e.g. while parsing the
+   kernel command line.  Returns true if successful, false if BPS
+   is not a supported rate. */
+bool
+serial_set_rate (int bps)
+{
+  enum intr_level old_level;
+
+  if (bps < 300 || bps > BASE_RATE || BASE_RATE % bps != 0)
+    return false;
+
+  old_level = intr_disable ();
+  serial_bps = bps;
+  if (mode != UNINIT)
+    {
+      /* Let queued bytes go out at the old rate. */
+      while (!intq_empty (&txq))
+        putc_poll (intq_getc (&txq));
+      while ((inb (LSR_REG) & LSR_TEMT) == 0)
+        continue;
+      set_serial (bps);
+    }
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Configures the serial port for BPS bits per second. */
 static void
 set_serial (int bps)
 {
-  int base_rate = 1843200 / 16;         /* Base rate of 16550A, in Hz. */
-  uint16_t divisor = base_rate / bps;   /* Clock rate divisor. */
+  uint16_t divisor = BASE_RATE / bps;   /* Clock rate divisor. */
 
-  ASSERT (bps >= 300 && bps <= 115200);
+  ASSERT (bps >= 300 && bps <= BASE_RATE);
 
   /* Enable DLAB. */
   outb (LCR_REG, LCR_N81 | LCR_DLAB);
@@ -219,9 +277,15 @@ serial_interrupt (struct intr_frame *f UNUSED)
     input_putc (inb (RBR_REG));
 
   /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
+     ready to accept bytes for transmission, transmit as many as
+     it has room for.  THRE means the FIFO, if any, is empty. */
   while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+    {
+      int i;
+
+      for (i = 0; i < xmit_burst && !intq_empty (&txq); i++)
+        outb (THR_REG, intq_getc (&txq));
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -1,11 +1,13 @@
 #ifndef DEVICES_SERIAL_H
 #define DEVICES_SERIAL_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 void serial_init_queue (void);
 void serial_putc (uint8_t);
 void serial_flush (void);
 void serial_notify (void);
+bool serial_set_rate (int bps);
 
 #endif /* devices/serial.h */
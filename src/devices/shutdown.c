@@ -8,6 +8,13 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
+#endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/page.h"
+#include "vm/swap.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -57,6 +64,7 @@ void
 shutdown_reboot (void)
 {
   printf ("Rebooting...\n");
+  console_flush ();
 
     /* See [kbd] for details on how to program the keyboard
      * controller. */
@@ -97,6 +105,7 @@ shutdown_power_off (void)
   print_stats ();
 
   printf ("Powering off...\n");
+  console_flush ();
   serial_flush ();
 
   /* ACPI shutdown. Thanks:
@@ -138,5 +147,12 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  process_print_stats ();
+#endif
+#ifdef VM
+  page_print_stats ();
+  frame_print_stats ();
+  ksm_print_stats ();
+  swap_print_stats ();
 #endif
 }
@@ -7,6 +7,10 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#endif
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -172,6 +176,10 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick ();
+#ifdef VM
+  frame_tick ();
+  ksm_tick ();
+#endif
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -3,8 +3,12 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of programs in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -31,19 +35,92 @@ main (void)
           /* Empty command. */
         }
       else
-        {
-          pid_t pid = exec (command);
-          if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
-        }
+        run_pipeline (command);
     }
 
   printf ("Shell exiting.");
   return EXIT_SUCCESS;
 }
 
+/* Runs COMMAND, which is one or more programs separated by `|',
+   with each program's output going to the input of the next
+   through a pipe, and waits for all of them. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int saved_in, saved_out, prev_read = -1;
+  char *stage, *save_ptr;
+  int i;
+
+  /* Split COMMAND into programs, trimming spaces. */
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      char *end;
+
+      if (stage_cnt == MAX_STAGES)
+        {
+          printf ("too many programs in pipeline\n");
+          return;
+        }
+      while (*stage == ' ')
+        stage++;
+      for (end = stage + strlen (stage); end > stage && end[-1] == ' '; )
+        *--end = '\0';
+      stages[stage_cnt++] = stage;
+    }
+
+  /* Start the programs, each with its input and output redirected
+     as needed.  A child inherits our standard input and output. */
+  saved_in = dup (STDIN_FILENO);
+  saved_out = dup (STDOUT_FILENO);
+  for (i = 0; i < stage_cnt; i++) 
+    {
+      if (prev_read >= 0) 
+        {
+          dup2 (prev_read, STDIN_FILENO);
+          close (prev_read);
+          prev_read = -1;
+        }
+      if (i < stage_cnt - 1) 
+        {
+          int fds[2];
+
+          if (!pipe (fds)) 
+            break;
+          dup2 (fds[1], STDOUT_FILENO);
+          close (fds[1]);
+          prev_read = fds[0];
+        }
+      else
+        dup2 (saved_out, STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+    }
+
+  /* Restore our own input and output.  This also closes our
+     references to the pipes, so that each program sees end of
+     file once the program before it exits. */
+  dup2 (saved_in, STDIN_FILENO);
+  dup2 (saved_out, STDOUT_FILENO);
+  close (saved_in);
+  close (saved_out);
+  if (prev_read >= 0)
+    close (prev_read);
+  if (i < stage_cnt)
+    printf ("pipe failed\n");
+
+  /* Wait for the programs we started. */
+  stage_cnt = i;
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("exec failed\n");
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -36,6 +36,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;                 /* Number of writes so far. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -136,6 +137,7 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
@@ -264,6 +266,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
   if (inode->deny_write_cnt)
     return 0;
+  inode->write_cnt++;
 
   while (size > 0) 
     {
@@ -337,6 +340,22 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns the number of times INODE has been written since it
+   was opened, which callers may compare to detect changes as
+   long as they keep INODE open. */
+unsigned
+inode_write_cnt (const struct inode *inode) 
+{
+  return inode->write_cnt;
+}
+
+/* Returns true if INODE has been removed, false otherwise. */
+bool
+inode_is_removed (const struct inode *inode) 
+{
+  return inode->removed;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
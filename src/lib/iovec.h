@@ -0,0 +1,17 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One segment of a buffer for the readv and writev system
+   calls. */
+struct iovec
+  {
+    void *iov_base;             /* Start of segment. */
+    size_t iov_len;             /* Length of segment in bytes. */
+  };
+
+/* Most segments that readv or writev accept. */
+#define IOV_MAX 32
+
+#endif /* lib/iovec.h */
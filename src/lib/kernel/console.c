@@ -1,14 +1,17 @@
 #include <console.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void write_have_lock (const char *, size_t);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,14 +62,58 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* Console output buffer.
+
+   Once console_start() has been called, writers only append to
+   this circular buffer, and a flusher thread copies its contents
+   to the vga display and serial port in chunks.  Writers thus
+   don't wait for the serial port, which is slow, unless the
+   buffer fills up, and the console lock is held only as long as
+   it takes to copy their output into the buffer.
+
+   The buffer is shared with writers in interrupt context, so it
+   is protected by disabling interrupts rather than by a lock.
+   Writers that cannot sleep (in interrupt context, with
+   interrupts off, or after a panic) and find the buffer full
+   drain it themselves.  Output that the flusher has taken but
+   not yet written can then appear out of order, which is
+   acceptable in those unusual cases. */
+#define CONSOLE_BUF_SIZE 8192
+static char cbuf[CONSOLE_BUF_SIZE];
+static size_t cbuf_head;                /* Next byte to append. */
+static size_t cbuf_tail;                /* Next byte to flush. */
+
+/* Most bytes the flusher writes out per trip to the buffer. */
+#define FLUSH_CHUNK 64
+
+static bool flusher_running;    /* Has console_start() been called? */
+static bool flusher_busy;       /* Writing out a chunk? */
+static bool flusher_waiting;    /* Waiting on flush_sema? */
+static struct semaphore flush_sema; /* Upped when output arrives. */
+static struct semaphore done_sema;  /* Upped when a chunk is out. */
+static int done_waiters;        /* Threads waiting on done_sema. */
+
+static thread_func flusher NO_RETURN;
+
 /* Enable console locking. */
 void
 console_init (void) 
 {
   lock_init (&console_lock);
+  sema_init (&flush_sema, 0);
+  sema_init (&done_sema, 0);
   use_console_lock = true;
 }
 
+/* Starts the thread that flushes buffered console output.
+   Until this is called, output is written out immediately. */
+void
+console_start (void) 
+{
+  if (thread_create ("console", PRI_DEFAULT, flusher, NULL) != TID_ERROR)
+    flusher_running = true;
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
    now on. */
@@ -140,8 +187,7 @@ int
 puts (const char *s) 
 {
   acquire_console ();
-  while (*s != '\0')
-    putchar_have_lock (*s++);
+  write_have_lock (s, strlen (s));
   putchar_have_lock ('\n');
   release_console ();
 
@@ -153,8 +199,7 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  write_have_lock (buffer, n);
   release_console ();
 }
 
@@ -184,8 +229,134 @@ vprintf_helper (char c, void *char_cnt_)
 static void
 putchar_have_lock (uint8_t c) 
 {
+  char ch = c;
+  write_have_lock (&ch, 1);
+}
+
+/* Writes the N bytes in S to the vga display and serial port,
+   bypassing the console buffer. */
+static void
+emit (const char *s, size_t n) 
+{
+  for (; n > 0; n--, s++)
+    {
+      serial_putc (*s);
+      vga_putc (*s);
+    }
+}
+
+/* Writes out everything in the console buffer from the current
+   thread.  Interrupts must be off. */
+static void
+drain_buffer (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  for (; cbuf_tail != cbuf_head; cbuf_tail++)
+    emit (&cbuf[cbuf_tail % CONSOLE_BUF_SIZE], 1);
+}
+
+/* Waits until the flusher has written out another chunk.
+   Interrupts must be off. */
+static void
+wait_for_flusher (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  done_waiters++;
+  sema_down (&done_sema);
+}
+
+/* Writes the N bytes in S to the console, through the console
+   buffer if the flusher is running.  The caller has already
+   acquired the console lock if appropriate. */
+static void
+write_have_lock (const char *s, size_t n) 
+{
+  enum intr_level old_level;
+  bool can_sleep;
+
   ASSERT (console_locked_by_current_thread ());
-  write_cnt++;
-  serial_putc (c);
-  vga_putc (c);
+  write_cnt += n;
+
+  old_level = intr_disable ();
+  if (!flusher_running || !use_console_lock)
+    {
+      /* Write out earlier output first, to keep it in order. */
+      drain_buffer ();
+      emit (s, n);
+      intr_set_level (old_level);
+      return;
+    }
+
+  can_sleep = old_level == INTR_ON && !intr_context ();
+  while (n > 0)
+    {
+      size_t room = CONSOLE_BUF_SIZE - (cbuf_head - cbuf_tail);
+      size_t chunk;
+
+      if (room == 0)
+        {
+          if (can_sleep)
+            wait_for_flusher ();
+          else
+            drain_buffer ();
+          continue;
+        }
+
+      for (chunk = n < room ? n : room; chunk > 0; chunk--, n--)
+        cbuf[cbuf_head++ % CONSOLE_BUF_SIZE] = *s++;
+      if (flusher_waiting)
+        {
+          flusher_waiting = false;
+          sema_up (&flush_sema);
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Waits until all buffered console output has been handed to
+   the vga display and serial port.  From a context that cannot
+   sleep, writes it out directly instead. */
+void
+console_flush (void) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (!flusher_running || intr_context () || old_level == INTR_OFF)
+    drain_buffer ();
+  else
+    while (cbuf_tail != cbuf_head || flusher_busy)
+      wait_for_flusher ();
+  intr_set_level (old_level);
+}
+
+/* Console flusher thread.  Repeatedly takes a chunk of output
+   from the console buffer and writes it out, waiting on the
+   serial port as necessary. */
+static void
+flusher (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      char chunk[FLUSH_CHUNK];
+      size_t n = 0;
+
+      intr_disable ();
+      while (cbuf_tail == cbuf_head)
+        {
+          flusher_waiting = true;
+          sema_down (&flush_sema);
+        }
+      while (n < FLUSH_CHUNK && cbuf_tail != cbuf_head)
+        chunk[n++] = cbuf[cbuf_tail++ % CONSOLE_BUF_SIZE];
+      flusher_busy = true;
+      intr_enable ();
+
+      emit (chunk, n);
+
+      intr_disable ();
+      flusher_busy = false;
+      for (; done_waiters > 0; done_waiters--)
+        sema_up (&done_sema);
+      intr_enable ();
+    }
 }
@@ -0,0 +1,224 @@
+#include <lz.h>
+#include <debug.h>
+#include <string.h>
+
+/* A fast LZ77 compressor in the style of LZ4.
+
+   Compressed data is a series of sequences.  Each sequence
+   begins with a token byte whose upper 4 bits give the number
+   of literal bytes that follow and whose lower 4 bits give the
+   length of the match after them, minus MIN_MATCH.  A 4-bit
+   count of 15 is continued by additional bytes that are added
+   to it, up to and including the first byte other than 255.
+   The literals come next, then the match's distance back into
+   the output as a 2-byte little-endian number, then any match
+   length continuation bytes.  The last sequence has literals
+   only, and it ends the data.
+
+   The compressor finds matches by hashing each 4-byte string
+   into a table that remembers where the string last appeared.
+   It never looks any further, so it is quick but not
+   thorough. */
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Longest distance a match can reach back. */
+#define MAX_DISTANCE 0xffff
+
+/* log2 of LZ_TABLE_SIZE. */
+#define HASH_BITS 10
+
+/* Largest 4-bit count. */
+#define RUN_MASK 15
+
+/* Returns the 4 bytes at P as an integer. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns the hash table index for the 4 bytes X. */
+static inline size_t
+hash32 (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Returns the number of bytes needed to continue a count of N
+   past its 4-bit field. */
+static inline size_t
+count_bytes (size_t n)
+{
+  return n >= RUN_MASK ? (n - RUN_MASK) / 255 + 1 : 0;
+}
+
+/* Writes the continuation bytes for count N at OP and returns
+   the byte just past them. */
+static uint8_t *
+put_count (uint8_t *op, size_t n)
+{
+  if (n >= RUN_MASK)
+    {
+      for (n -= RUN_MASK; n >= 255; n -= 255)
+        *op++ = 255;
+      *op++ = n;
+    }
+  return op;
+}
+
+/* Appends a sequence to the output at OP, which ends at OP_END,
+   consisting of the LIT_LEN bytes at LIT followed by a match of
+   MATCH_LEN bytes DISTANCE bytes back.  A MATCH_LEN of 0 writes
+   the final, literals-only sequence.
+   Returns the byte just past the sequence, or a null pointer if
+   it does not fit. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *op_end, const uint8_t *lit,
+              size_t lit_len, size_t distance, size_t match_len)
+{
+  size_t need = 1 + count_bytes (lit_len) + lit_len;
+  size_t lit_code = lit_len < RUN_MASK ? lit_len : RUN_MASK;
+  size_t match_code = 0;
+  bool has_match = match_len > 0;
+
+  if (has_match)
+    {
+      match_len -= MIN_MATCH;
+      match_code = match_len < RUN_MASK ? match_len : RUN_MASK;
+      need += 2 + count_bytes (match_len);
+    }
+  if (need > (size_t) (op_end - op))
+    return NULL;
+
+  *op++ = (lit_code << 4) | match_code;
+  op = put_count (op, lit_len);
+  memcpy (op, lit, lit_len);
+  op += lit_len;
+  if (has_match)
+    {
+      *op++ = distance & 0xff;
+      *op++ = distance >> 8;
+      op = put_count (op, match_len);
+    }
+  return op;
+}
+
+/* Compresses the SIZE bytes at SRC, which must be less than 64
+   kB, into the CAPACITY bytes at DST, using TABLE as scratch
+   space.  Returns the number of bytes of compressed data, or 0
+   if they would not fit in CAPACITY bytes. */
+size_t
+lz_compress (const void *src_, size_t size, void *dst_, size_t capacity,
+             uint16_t table[LZ_TABLE_SIZE])
+{
+  const uint8_t *src = src_;
+  const uint8_t *end = src + size;
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  uint8_t *op = dst_;
+  uint8_t *op_end = op + capacity;
+
+  ASSERT (size <= MAX_DISTANCE);
+
+  memset (table, 0, LZ_TABLE_SIZE * sizeof *table);
+  while (end - ip >= MIN_MATCH)
+    {
+      uint32_t x = read32 (ip);
+      size_t h = hash32 (x);
+      const uint8_t *ref = src + table[h];
+      size_t len;
+
+      table[h] = ip - src;
+      if (ref >= ip || read32 (ref) != x)
+        {
+          ip++;
+          continue;
+        }
+
+      for (len = MIN_MATCH; ip + len < end && ref[len] == ip[len]; len++)
+        continue;
+      op = put_sequence (op, op_end, anchor, ip - anchor, ip - ref, len);
+      if (op == NULL)
+        return 0;
+      ip += len;
+      anchor = ip;
+    }
+
+  op = put_sequence (op, op_end, anchor, end - anchor, 0, 0);
+  if (op == NULL)
+    return 0;
+  return op - (uint8_t *) dst_;
+}
+
+/* Reads a count that began as the 4-bit value N from *IP, which
+   must stay below END, advancing *IP past any continuation
+   bytes.  Returns the count, or SIZE_MAX if the data ends
+   early. */
+static size_t
+get_count (const uint8_t **ip, const uint8_t *end, size_t n)
+{
+  if (n == RUN_MASK)
+    {
+      uint8_t b;
+      do
+        {
+          if (*ip >= end)
+            return SIZE_MAX;
+          b = *(*ip)++;
+          n += b;
+        }
+      while (b == 255);
+    }
+  return n;
+}
+
+/* Decompresses the SIZE bytes of compressed data at SRC into
+   the DST_SIZE bytes at DST.  Returns true if successful, false
+   if the data is corrupt or does not decompress to exactly
+   DST_SIZE bytes. */
+bool
+lz_decompress (const void *src, size_t size, void *dst_, size_t dst_size)
+{
+  const uint8_t *ip = src;
+  const uint8_t *end = ip + size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+
+  while (ip < end)
+    {
+      uint8_t token = *ip++;
+      size_t lit_len, match_len, distance;
+
+      lit_len = get_count (&ip, end, token >> 4);
+      if (lit_len > (size_t) (end - ip) || lit_len > (size_t) (op_end - op))
+        return false;
+      memcpy (op, ip, lit_len);
+      ip += lit_len;
+      op += lit_len;
+      if (ip == end)
+        break;
+
+      if (end - ip < 2)
+        return false;
+      distance = ip[0] | (ip[1] << 8);
+      ip += 2;
+      match_len = get_count (&ip, end, token & RUN_MASK);
+      if (match_len == SIZE_MAX)
+        return false;
+      match_len += MIN_MATCH;
+      if (distance == 0 || distance > (size_t) (op - dst)
+          || match_len > (size_t) (op_end - op))
+        return false;
+
+      /* The match may overlap the bytes it produces, so copy it
+         one byte at a time. */
+      for (; match_len > 0; match_len--, op++)
+        *op = op[-distance];
+    }
+  return op == op_end;
+}
@@ -0,0 +1,17 @@
+#ifndef __LIB_LZ_H
+#define __LIB_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of entries in the table that lz_compress() uses as
+   scratch space.  The table is too big to put on a kernel
+   stack, so the caller supplies it. */
+#define LZ_TABLE_SIZE 1024
+
+size_t lz_compress (const void *src, size_t size, void *dst, size_t capacity,
+                    uint16_t table[LZ_TABLE_SIZE]);
+bool lz_decompress (const void *src, size_t size, void *dst, size_t dst_size);
+
+#endif /* lib/lz.h */
@@ -0,0 +1,19 @@
+#ifndef __LIB_MEMUSAGE_H
+#define __LIB_MEMUSAGE_H
+
+#include <stddef.h>
+
+/* A process's use of memory, as reported by the memusage system
+   call.  Sizes are in pages. */
+struct memusage
+  {
+    size_t resident;            /* Pages held in frames. */
+    size_t working_set;         /* Pages accessed recently. */
+    size_t soft_limit;          /* Resident pages above which the
+                                   process is evicted first, or 0. */
+    size_t hard_limit;          /* Most resident pages, or 0. */
+    unsigned long faults;       /* Pages brought in by faults. */
+    unsigned long evictions;    /* Pages evicted. */
+  };
+
+#endif /* lib/memusage.h */
@@ -0,0 +1,95 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Submission and completion rings.
+
+   The ring_setup system call maps three areas into the calling
+   process, shared with the kernel: a submission ring, a
+   completion ring, and a buffer area.  The process queues
+   operations by filling in struct ring_sqe entries and
+   advancing the submission ring's tail, then calls ring_enter
+   to hand any number of them to the kernel at once.  Kernel
+   worker threads carry out each process's operations in the
+   order submitted, and post a struct ring_cqe for each one at
+   the completion ring's tail.  The process consumes
+   completions by advancing the completion ring's head, without
+   a system call.
+
+   Each ring holds RING_ENTRIES entries, indexed modulo
+   RING_ENTRIES by free-running head and tail counters.  The
+   kernel never has more operations outstanding than there is
+   room for completions, so submissions wait in the ring while
+   the completion ring is full.
+
+   Operations name files by slot in a table of RING_FILES files
+   private to the ring, not by file descriptor, and transfer
+   data to and from the buffer area, not arbitrary memory. */
+
+/* Number of entries in each ring. */
+#define RING_ENTRIES 64
+
+/* Number of file slots. */
+#define RING_FILES 16
+
+/* Largest buffer area, in pages. */
+#define RING_BUF_PAGES_MAX 16
+
+/* Operations. */
+enum ring_opcode
+  {
+    RING_NOP,                   /* Do nothing. */
+    RING_OPEN,                  /* Open file named at BUF into FILE. */
+    RING_CLOSE,                 /* Close FILE. */
+    RING_READ,                  /* Read LEN bytes from FILE into BUF. */
+    RING_WRITE                  /* Write LEN bytes at BUF to FILE. */
+  };
+
+/* Submission queue entry. */
+struct ring_sqe
+  {
+    uint32_t opcode;            /* One of RING_*. */
+    int32_t file;               /* File slot. */
+    uint32_t buf;               /* Offset into buffer area. */
+    uint32_t len;               /* Number of bytes. */
+    int32_t pos;                /* File position, or -1 for current. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct ring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int32_t result;             /* Bytes transferred, 0, or -1. */
+  };
+
+/* Submission ring.  The process writes SQES and TAIL, the
+   kernel writes HEAD. */
+struct ring_sq
+  {
+    volatile uint32_t head;     /* Next entry the kernel takes. */
+    volatile uint32_t tail;     /* Next entry the process fills. */
+    struct ring_sqe sqes[RING_ENTRIES];
+  };
+
+/* Completion ring.  The kernel writes CQES and TAIL, the
+   process writes HEAD. */
+struct ring_cq
+  {
+    volatile uint32_t head;     /* Next entry the process takes. */
+    volatile uint32_t tail;     /* Next entry the kernel fills. */
+    struct ring_cqe cqes[RING_ENTRIES];
+  };
+
+/* Where ring_setup mapped the rings. */
+struct ring_params
+  {
+    struct ring_sq *sq;         /* Submission ring. */
+    struct ring_cq *cq;         /* Completion ring. */
+    void *bufs;                 /* Buffer area. */
+    size_t buf_size;            /* Size of buffer area in bytes. */
+  };
+
+#endif /* lib/ring.h */
@@ -0,0 +1,30 @@
+#ifndef __LIB_SHM_H
+#define __LIB_SHM_H
+
+/* Shared memory segments.
+
+   The shm_create system call makes a named segment of zeroed
+   pages, and shm_attach maps all of a segment's pages, by name,
+   at a page-aligned address in the calling process.  Every
+   process that attaches a segment sees the same memory, so a
+   store by one is visible to the others at once.  shm_detach
+   unmaps an attachment given its address.  A segment lives from
+   its creation until its last attachment is detached, whether
+   explicitly or by process exit, and then its name may be used
+   again.  A segment that is never attached lives until the
+   process that created it exits.
+
+   Segment pages come out of kernel memory, so all the segments
+   in the system together may hold at most SHM_TOTAL_PAGES_MAX
+   pages.  shm_create fails when a new segment would go over. */
+
+/* Longest segment name, in characters. */
+#define SHM_NAME_MAX 14
+
+/* Largest segment, in pages. */
+#define SHM_PAGES_MAX 512
+
+/* Most pages in all segments together. */
+#define SHM_TOTAL_PAGES_MAX 1024
+
+#endif /* lib/shm.h */
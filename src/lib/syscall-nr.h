@@ -28,7 +28,21 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SBRK,                   /* Change the size of the heap. */
+    SYS_MEMUSAGE,               /* Reports the process's memory use. */
+    SYS_READV,                  /* Read from a file into segments. */
+    SYS_WRITEV,                 /* Write to a file from segments. */
+    SYS_RING_SETUP,             /* Map submission and completion rings. */
+    SYS_RING_ENTER,             /* Submit and wait for ring operations. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto a given descriptor. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SHM_CREATE,             /* Create a shared memory segment. */
+    SYS_SHM_ATTACH,             /* Map a shared memory segment. */
+    SYS_SHM_DETACH              /* Unmap a shared memory segment. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,399 @@
+#include <stdlib.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A simple implementation of malloc() for user programs.
+
+   Every block begins with a header giving its size.  Blocks of
+   up to SMALL_MAX bytes, counting the header, are "small":
+   their size is rounded up to a power of 2 and they are kept on
+   one free list per size.  When a list is empty, a SLAB_SIZE
+   block is taken from the large allocator and carved into new
+   blocks of that size.  Small blocks are never coalesced or
+   returned to the large allocator, so freeing and reallocating
+   small blocks of the same size is just a list operation.
+
+   Larger blocks are allocated first-fit from a list of free
+   blocks carved out of the heap.  Each header also records the
+   size of the block just below it in memory, so a block being
+   freed is merged with free neighbors on both sides.  The top
+   of the heap is marked by a header for an empty, in-use
+   block, so that no block ever merges past the end of the heap.
+   When no free block is large enough, the heap is grown with
+   sbrk() by at least GROW_SIZE bytes.
+
+   Thus, the common case of malloc() and free() makes no system
+   call at all. */
+
+/* Block header. */
+struct header
+  {
+    size_t size;                /* Block size in bytes, plus flags. */
+    size_t prev_size;           /* Size of block below, or 0. */
+  };
+
+/* Flags in the low bits of `size'. */
+#define USED 1                  /* Block is allocated. */
+#define SMALL 2                 /* Block belongs to a size class. */
+#define FLAGS (USED | SMALL)
+
+/* Free small block. */
+struct small_block
+  {
+    struct header header;
+    struct small_block *next;   /* Next free block of same size. */
+  };
+
+/* Free large block. */
+struct large_block
+  {
+    struct header header;
+    struct large_block *prev;   /* Previous free large block. */
+    struct large_block *next;   /* Next free large block. */
+  };
+
+#define MIN_SHIFT 4                     /* Smallest block is 16 bytes. */
+#define SMALL_MAX 2048                  /* Largest small block. */
+#define CLASS_CNT 8                     /* 16, 32, ..., 2048. */
+#define SLAB_SIZE (16 * 1024)           /* Small blocks carved at once. */
+#define MIN_LARGE 32                    /* Smallest large block. */
+#define GROW_SIZE (64 * 1024)           /* Minimum heap growth. */
+
+/* Free lists. */
+static struct small_block *small_free[CLASS_CNT];
+static struct large_block *large_free;
+
+/* Header for the empty block at the top of the heap. */
+static struct header *heap_top;
+
+/* Returns the size of block H. */
+static inline size_t
+block_size (const struct header *h)
+{
+  return h->size & ~FLAGS;
+}
+
+/* Returns the block just above H in memory. */
+static inline struct header *
+next_block (struct header *h)
+{
+  return (struct header *) ((uint8_t *) h + block_size (h));
+}
+
+/* Returns the block just below H in memory,
+   or a null pointer if there is none. */
+static inline struct header *
+prev_block (struct header *h)
+{
+  return (h->prev_size != 0
+          ? (struct header *) ((uint8_t *) h - h->prev_size)
+          : NULL);
+}
+
+/* Sets large block H's SIZE and FLAGS, and records SIZE in the
+   block above H. */
+static void
+set_size (struct header *h, size_t size, size_t flags)
+{
+  h->size = size | flags;
+  next_block (h)->prev_size = size;
+}
+
+/* Adds H to the large free list. */
+static void
+large_insert (struct header *h)
+{
+  struct large_block *b = (struct large_block *) h;
+  b->prev = NULL;
+  b->next = large_free;
+  if (large_free != NULL)
+    large_free->prev = b;
+  large_free = b;
+}
+
+/* Removes H from the large free list. */
+static void
+large_remove (struct header *h)
+{
+  struct large_block *b = (struct large_block *) h;
+  if (b->prev != NULL)
+    b->prev->next = b->next;
+  else
+    large_free = b->next;
+  if (b->next != NULL)
+    b->next->prev = b->prev;
+}
+
+/* Frees large block H, merging it with any free neighbors. */
+static void
+large_free_block (struct header *h)
+{
+  size_t size = block_size (h);
+  struct header *next = next_block (h);
+  struct header *prev = prev_block (h);
+
+  if ((next->size & USED) == 0)
+    {
+      large_remove (next);
+      size += block_size (next);
+    }
+  if (prev != NULL && (prev->size & USED) == 0)
+    {
+      large_remove (prev);
+      size += block_size (prev);
+      h = prev;
+    }
+  set_size (h, size, 0);
+  large_insert (h);
+}
+
+/* Grows the heap by enough to hold a block of SIZE bytes and
+   adds the new space to the large free list.
+   Returns true if successful, false if the heap is full. */
+static bool
+grow_heap (size_t size)
+{
+  size_t increment = ROUND_UP (size + sizeof (struct header), GROW_SIZE);
+  uint8_t *old_brk = sbrk (increment);
+  uint8_t *new_brk = old_brk + increment;
+  struct header *h;
+
+  if (old_brk == (uint8_t *) -1)
+    return false;
+
+  if (heap_top != NULL && old_brk == (uint8_t *) (heap_top + 1))
+    {
+      /* Extend the heap, turning the old top into a block. */
+      h = heap_top;
+    }
+  else
+    {
+      /* First call, or someone else moved the break: start a new
+         region with nothing below it. */
+      h = (struct header *) ROUND_UP ((uintptr_t) old_brk,
+                                      sizeof (struct header));
+      h->prev_size = 0;
+    }
+
+  heap_top = (struct header *) (ROUND_DOWN ((uintptr_t) new_brk,
+                                            sizeof (struct header))
+                                - sizeof (struct header));
+  h->size = ((uint8_t *) heap_top - (uint8_t *) h) | USED;
+  heap_top->size = USED;
+  heap_top->prev_size = block_size (h);
+
+  large_free_block (h);
+  return true;
+}
+
+/* Returns a large block of at least SIZE bytes, counting the
+   header, or a null pointer if memory is exhausted. */
+static struct header *
+large_alloc (size_t size)
+{
+  struct large_block *b;
+
+  size = ROUND_UP (size, sizeof (struct header));
+  if (size < MIN_LARGE)
+    size = MIN_LARGE;
+
+  for (;;)
+    {
+      for (b = large_free; b != NULL; b = b->next)
+        {
+          struct header *h = &b->header;
+          size_t avail = block_size (h);
+          if (avail < size)
+            continue;
+
+          large_remove (h);
+          if (avail - size >= MIN_LARGE)
+            {
+              /* Split off the excess as a free block. */
+              set_size (h, size, USED);
+              set_size (next_block (h), avail - size, 0);
+              large_insert (next_block (h));
+            }
+          else
+            set_size (h, avail, USED);
+          return h;
+        }
+
+      if (!grow_heap (size))
+        return NULL;
+    }
+}
+
+/* Returns the size class for a small block of SIZE bytes,
+   counting the header. */
+static size_t
+size_class (size_t size)
+{
+  size_t class = 0;
+  while (((size_t) 1 << (class + MIN_SHIFT)) < size)
+    class++;
+  return class;
+}
+
+/* Refills the free list for size CLASS from a new slab.
+   Returns true if successful, false if memory is exhausted. */
+static bool
+refill (size_t class)
+{
+  size_t size = (size_t) 1 << (class + MIN_SHIFT);
+  struct header *slab = large_alloc (SLAB_SIZE);
+  uint8_t *p, *end;
+
+  if (slab == NULL)
+    return false;
+
+  p = (uint8_t *) (slab + 1);
+  end = (uint8_t *) slab + block_size (slab);
+  for (; p + size <= end; p += size)
+    {
+      struct small_block *b = (struct small_block *) p;
+      b->header.size = size | SMALL;
+      b->header.prev_size = 0;
+      b->next = small_free[class];
+      small_free[class] = b;
+    }
+  return true;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  struct header *h;
+
+  if (size == 0 || size > SIZE_MAX / 2)
+    return NULL;
+  size += sizeof (struct header);
+
+  if (size <= SMALL_MAX)
+    {
+      size_t class = size_class (size);
+      struct small_block *b = small_free[class];
+      if (b == NULL)
+        {
+          if (!refill (class))
+            return NULL;
+          b = small_free[class];
+        }
+      small_free[class] = b->next;
+      h = &b->header;
+      h->size |= USED;
+    }
+  else
+    {
+      h = large_alloc (size);
+      if (h == NULL)
+        return NULL;
+    }
+  return h + 1;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  size = a * b;
+  if (size < a || size < b)
+    return NULL;
+
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  struct header *h;
+  size_t old_size;
+  void *new_block;
+
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (old_block == NULL)
+    return malloc (new_size);
+  if (new_size > SIZE_MAX / 2)
+    return NULL;
+
+  h = (struct header *) old_block - 1;
+  old_size = block_size (h) - sizeof (struct header);
+  if (new_size <= old_size)
+    return old_block;
+
+  /* Grow a large block in place if the block above is free. */
+  if ((h->size & SMALL) == 0)
+    {
+      struct header *next = next_block (h);
+      size_t need = ROUND_UP (new_size + sizeof (struct header),
+                              sizeof (struct header));
+      size_t avail = block_size (h) + block_size (next);
+      if ((next->size & USED) == 0 && avail >= need)
+        {
+          large_remove (next);
+          if (avail - need >= MIN_LARGE)
+            {
+              set_size (h, need, USED);
+              set_size (next_block (h), avail - need, 0);
+              large_insert (next_block (h));
+            }
+          else
+            set_size (h, avail, USED);
+          return old_block;
+        }
+    }
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block, old_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  struct header *h;
+
+  if (p == NULL)
+    return;
+
+  h = (struct header *) p - 1;
+  ASSERT (h->size & USED);
+  if (h->size & SMALL)
+    {
+      struct small_block *b = (struct small_block *) h;
+      size_t class = size_class (block_size (h));
+      h->size &= ~USED;
+      b->next = small_free[class];
+      small_free[class] = b;
+    }
+  else
+    large_free_block (h);
+}
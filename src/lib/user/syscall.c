@@ -1,31 +1,67 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* Nonzero if the CPU supports SYSENTER, which the kernel then
+   accepts in place of "int $0x30".  Set by syscall_detect(). */
+static int use_sysenter;
+
+/* Checks whether the CPU supports SYSENTER and SYSEXIT, by the
+   same test as the kernel's tss_init().  Called by _start(). */
+void
+syscall_detect (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  use_sysenter = ((edx & (1u << 11)) != 0
+                  && !(family == 6 && model < 3 && stepping < 3));
+}
+
+/* Traps into the kernel, with the system call number and its
+   arguments already pushed on the stack.  SYSENTER saves neither
+   the stack pointer nor the return address, so they are passed
+   in ECX and EDX, which the kernel restores on return. */
+#define SYSCALL_TRAP                            \
+        "cmpl $0, %[fast]; jne 1f; "            \
+        "int $0x30; jmp 2f; "                   \
+        "1: movl %%esp, %%ecx; "                \
+        "movl $2f, %%edx; "                     \
+        "sysenter; "                            \
+        "2: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $4, %%esp"                                   \
                : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (use_sysenter)                      \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $8, %%esp"                                   \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [fast] "m" (use_sysenter)                      \
+               : "ecx", "edx", "memory");                       \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +71,14 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $12, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
+                 [arg1] "r" (ARG1),                             \
+                 [fast] "m" (use_sysenter)                      \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -51,13 +89,15 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $16, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1),                             \
-                 [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
+                 [arg2] "r" (ARG2),                             \
+                 [fast] "m" (use_sysenter)                      \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -182,3 +222,82 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+brk (void *end)
+{
+  void *cur = sbrk (0);
+  return sbrk ((char *) end - (char *) cur) == (void *) -1 ? -1 : 0;
+}
+
+bool
+memusage (struct memusage *u)
+{
+  return syscall1 (SYS_MEMUSAGE, u);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+bool
+ring_setup (size_t buf_pages, struct ring_params *params)
+{
+  return syscall2 (SYS_RING_SETUP, buf_pages, params);
+}
+
+int
+ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_RING_ENTER, to_submit, min_complete);
+}
+
+int
+dup (int fd)
+{
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int fd, int new_fd)
+{
+  return syscall2 (SYS_DUP2, fd, new_fd);
+}
+
+bool
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+bool
+shm_create (const char *name, size_t page_cnt)
+{
+  return syscall2 (SYS_SHM_CREATE, name, page_cnt);
+}
+
+void *
+shm_attach (const char *name, void *addr)
+{
+  return (void *) syscall2 (SYS_SHM_ATTACH, name, addr);
+}
+
+bool
+shm_detach (void *addr)
+{
+  return syscall1 (SYS_SHM_DETACH, addr);
+}
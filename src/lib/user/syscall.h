@@ -2,7 +2,12 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <iovec.h>
+#include <memusage.h>
+#include <ring.h>
+#include <shm.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +50,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void *sbrk (intptr_t increment);
+int brk (void *end);
+bool memusage (struct memusage *);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+bool ring_setup (size_t buf_pages, struct ring_params *);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+int dup (int fd);
+int dup2 (int fd, int new_fd);
+bool pipe (int fds[2]);
+bool shm_create (const char *name, size_t page_cnt);
+void *shm_attach (const char *name, void *addr);
+bool shm_detach (void *addr);
+
+/* Chooses how to enter the kernel.  Called by _start(). */
+void syscall_detect (void);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,26 @@
+/* Child process run by shm-share test.
+   Attaches the "shm-share" segment, replaces the parent's
+   message in its second page, creates a segment that nothing
+   attaches, and exits without detaching. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Where this process attaches the segment. */
+#define SHM_BASE ((char *) 0x20000000)
+
+const char *test_name = "child-shm";
+
+int
+main (void) 
+{
+  if (shm_attach ("shm-share", SHM_BASE) != SHM_BASE)
+    fail ("attach failed");
+  if (strcmp (SHM_BASE + 4096, "parent"))
+    fail ("segment holds \"%s\" instead of \"parent\"", SHM_BASE + 4096);
+  strlcpy (SHM_BASE + 4096, "child", 16);
+  if (!shm_create ("shm-unused", 1))
+    fail ("create failed");
+  return 0;
+}
@@ -0,0 +1,39 @@
+/* Duplicates a file descriptor with dup() and dup2() and checks
+   that the duplicates share one file position, that the file
+   stays open until its last descriptor is closed, and that
+   open() and dup() return the lowest free handle. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  size_t rest = sizeof sample - 1 - 10;
+  int handle, copy, copy2;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((copy = dup (handle)) == handle + 1, "dup");
+  CHECK ((copy2 = dup2 (copy, 100)) == 100, "dup2 to 100");
+
+  if (read (handle, buf, 10) != 10)
+    fail ("read() returned wrong count");
+  if (tell (copy) != 10 || tell (copy2) != 10)
+    fail ("duplicates do not share the file position");
+
+  msg ("close original");
+  close (handle);
+  if (read (copy2, buf + 10, rest) != (int) rest)
+    fail ("read() after close returned wrong count");
+  if (memcmp (buf, sample, 10 + rest))
+    fail ("read of duplicate returned wrong data");
+
+  CHECK (open ("sample.txt") == handle, "open reuses lowest handle");
+  msg ("close duplicates");
+  close (copy);
+  close (copy2);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup-shared) begin
+(dup-shared) open "sample.txt"
+(dup-shared) dup
+(dup-shared) dup2 to 100
+(dup-shared) close original
+(dup-shared) open reuses lowest handle
+(dup-shared) close duplicates
+(dup-shared) end
+dup-shared: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Passes data through a pipe within one process: a short
+   message, then two whole pages, then checks for end of file
+   once the write end is closed and for failure when writing
+   with the read end closed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char out[8192], in[8192];
+
+void
+test_main (void) 
+{
+  int fds[2];
+  size_t i;
+
+  for (i = 0; i < sizeof out; i++)
+    out[i] = i * 7 + i / 256;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK (write (fds[1], "hello", 5) == 5, "write short message");
+  CHECK (read (fds[0], in, sizeof in) == 5 && !memcmp (in, "hello", 5),
+         "read short message");
+  CHECK (write (fds[1], out, sizeof out) == sizeof out, "write two pages");
+  CHECK (read (fds[0], in, sizeof in) == sizeof in
+         && !memcmp (in, out, sizeof in), "read two pages");
+
+  msg ("close write end");
+  close (fds[1]);
+  CHECK (read (fds[0], in, sizeof in) == 0, "read at end of file");
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe");
+  msg ("close read end");
+  close (fds[0]);
+  CHECK (write (fds[1], "hello", 5) == -1, "write without reader");
+  close (fds[1]);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-basic) begin
+(pipe-basic) pipe
+(pipe-basic) write short message
+(pipe-basic) read short message
+(pipe-basic) write two pages
+(pipe-basic) read two pages
+(pipe-basic) close write end
+(pipe-basic) read at end of file
+(pipe-basic) pipe
+(pipe-basic) close read end
+(pipe-basic) write without reader
+(pipe-basic) end
+pipe-basic: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Runs a child with its standard output redirected to a pipe
+   and reads what it printed from the other end. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char expected[] = "(child-simple) run\n";
+  char buf[64];
+  size_t len = 0;
+  int fds[2], saved, n;
+  pid_t pid;
+
+  CHECK (pipe (fds), "pipe");
+  saved = dup (STDOUT_FILENO);
+  dup2 (fds[1], STDOUT_FILENO);
+  close (fds[1]);
+  pid = exec ("child-simple");
+  dup2 (saved, STDOUT_FILENO);
+  close (saved);
+  if (pid == PID_ERROR)
+    fail ("exec() failed");
+
+  /* Reads see end of file once the child exits. */
+  while ((n = read (fds[0], buf + len, sizeof buf - 1 - len)) > 0)
+    len += n;
+  buf[len] = '\0';
+  if (wait (pid) != 81)
+    fail ("wrong exit code");
+  if (strcmp (buf, expected))
+    fail ("read \"%s\" from pipe", buf);
+  msg ("read child's output from pipe");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-child) begin
+(pipe-child) pipe
+child-simple: exit(81)
+(pipe-child) read child's output from pipe
+(pipe-child) end
+pipe-child: exit(0)
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Opens a file, writes it, reads it back, and closes it through
+   the I/O rings, all with a single ring_enter() call, then
+   checks the completions and the data read back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Offsets into the buffer area. */
+#define NAME_OFS 0
+#define DATA_OFS 64
+#define READ_OFS 2048
+
+static void
+submit (struct ring_params *p, uint32_t opcode, uint32_t buf, uint32_t len)
+{
+  struct ring_sq *sq = p->sq;
+  struct ring_sqe *sqe = &sq->sqes[sq->tail % RING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->file = 0;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->pos = 0;
+  sqe->user_data = sq->tail;
+  sq->tail++;
+}
+
+void
+test_main (void) 
+{
+  size_t sample_len = sizeof sample - 1;
+  int32_t expected[4];
+  struct ring_params p;
+  struct ring_cq *cq;
+  char *bufs;
+  int i;
+
+  CHECK (create ("test.txt", sample_len), "create \"test.txt\"");
+  CHECK (ring_setup (1, &p), "ring_setup");
+  bufs = p.bufs;
+  cq = p.cq;
+
+  strlcpy (bufs + NAME_OFS, "test.txt", DATA_OFS);
+  memcpy (bufs + DATA_OFS, sample, sample_len);
+  submit (&p, RING_OPEN, NAME_OFS, DATA_OFS);
+  submit (&p, RING_WRITE, DATA_OFS, sample_len);
+  submit (&p, RING_READ, READ_OFS, sample_len);
+  submit (&p, RING_CLOSE, 0, 0);
+  expected[0] = 0;
+  expected[1] = sample_len;
+  expected[2] = sample_len;
+  expected[3] = 0;
+  CHECK (ring_enter (4, 4) == 4, "ring_enter");
+
+  if (cq->tail - cq->head != 4)
+    fail ("%u completions instead of 4", cq->tail - cq->head);
+  for (i = 0; i < 4; i++) 
+    {
+      struct ring_cqe *cqe = &cq->cqes[cq->head % RING_ENTRIES];
+      if (cqe->user_data != (uint32_t) i)
+        fail ("completion %d has user_data %u", i, cqe->user_data);
+      if (cqe->result != expected[i])
+        fail ("operation %d returned %d instead of %d",
+              i, cqe->result, expected[i]);
+      cq->head++;
+    }
+  if (memcmp (bufs + READ_OFS, sample, sample_len))
+    fail ("data read back differs from data written");
+}
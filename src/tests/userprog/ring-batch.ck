@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) create "test.txt"
+(ring-batch) ring_setup
+(ring-batch) ring_enter
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
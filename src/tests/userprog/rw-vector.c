@@ -0,0 +1,53 @@
+/* Writes a file with writev() from three segments, one of them
+   empty, then reads it back with readv() into two segments split
+   at a different point. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char header[] = "header: ";
+
+void
+test_main (void) 
+{
+  size_t header_len = sizeof header - 1;
+  size_t sample_len = sizeof sample - 1;
+  size_t size = header_len + sample_len;
+  char expected[sizeof header + sizeof sample];
+  char buf1[20], buf2[sizeof header + sizeof sample];
+  struct iovec out[3], in[2];
+  int handle, byte_cnt;
+
+  memcpy (expected, header, header_len);
+  memcpy (expected + header_len, sample, sample_len);
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  out[0].iov_base = header;
+  out[0].iov_len = header_len;
+  out[1].iov_base = sample;
+  out[1].iov_len = 0;
+  out[2].iov_base = sample;
+  out[2].iov_len = sample_len;
+  byte_cnt = writev (handle, out, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+
+  msg ("seek \"test.txt\" to 0");
+  seek (handle, 0);
+
+  in[0].iov_base = buf1;
+  in[0].iov_len = sizeof buf1;
+  in[1].iov_base = buf2;
+  in[1].iov_len = size - sizeof buf1;
+  byte_cnt = readv (handle, in, 2);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  if (memcmp (buf1, expected, sizeof buf1)
+      || memcmp (buf2, expected + sizeof buf1, size - sizeof buf1))
+    fail ("data read back differs from data written");
+}
@@ -0,0 +1,25 @@
+/* Fills the system-wide shared memory budget, checks that one
+   more page is refused, then releases a segment and checks that
+   its pages may be used again. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Where this process attaches a segment. */
+#define SHM_BASE ((char *) 0x10000000)
+
+void
+test_main (void) 
+{
+  CHECK (shm_create ("shm-limit-a", SHM_PAGES_MAX),
+         "create \"shm-limit-a\"");
+  CHECK (shm_create ("shm-limit-b", SHM_TOTAL_PAGES_MAX - SHM_PAGES_MAX),
+         "create \"shm-limit-b\"");
+  CHECK (!shm_create ("shm-limit-c", 1),
+         "create \"shm-limit-c\" over budget (must fail)");
+  CHECK (shm_attach ("shm-limit-a", SHM_BASE) == SHM_BASE,
+         "attach \"shm-limit-a\"");
+  CHECK (shm_detach (SHM_BASE), "detach \"shm-limit-a\"");
+  CHECK (shm_create ("shm-limit-c", 1), "create \"shm-limit-c\"");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-limit) begin
+(shm-limit) create "shm-limit-a"
+(shm-limit) create "shm-limit-b"
+(shm-limit) create "shm-limit-c" over budget (must fail)
+(shm-limit) attach "shm-limit-a"
+(shm-limit) detach "shm-limit-a"
+(shm-limit) create "shm-limit-c"
+(shm-limit) end
+shm-limit: exit(0)
+EOF
+pass;
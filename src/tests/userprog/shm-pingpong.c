@@ -0,0 +1,160 @@
+/* Passes a 1 MB buffer back and forth between this process and
+   a child ROUNDS times, each side rewriting all of it on every
+   turn, for "make shm-bench".  Run as "shm-pingpong shm" the
+   buffer is a shared memory segment attached by both processes;
+   run as "shm-pingpong file" each side writes the buffer to a
+   file and the other reads it back.  Either way the processes
+   hand off turns by writing a byte to a pipe, so the two runs
+   differ only in how the data moves. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Buffer size, in bytes. */
+#define BUF_SIZE (1024 * 1024)
+
+/* Number of round trips. */
+#define ROUNDS 32
+
+/* Where both processes attach the segment in "shm" mode. */
+#define SHM_BASE ((unsigned char *) 0x10000000)
+
+/* Names of the segment and the file. */
+#define SHM_NAME "pingpong"
+#define FILE_NAME "pingpong.dat"
+
+/* Buffer and, in "file" mode, the file backing it. */
+static unsigned char *buf;
+static int fd = -1;
+
+/* Makes the buffer available to this process, creating it first
+   if MAKE is true. */
+static void
+open_buffer (bool shm, bool make)
+{
+  if (shm)
+    {
+      if (make && !shm_create (SHM_NAME, BUF_SIZE / 4096))
+        fail ("shm_create failed");
+      buf = shm_attach (SHM_NAME, SHM_BASE);
+      if (buf == NULL)
+        fail ("shm_attach failed");
+    }
+  else
+    {
+      if (make && !create (FILE_NAME, BUF_SIZE))
+        fail ("create failed");
+      fd = open (FILE_NAME);
+      buf = malloc (BUF_SIZE);
+      if (fd < 0 || buf == NULL)
+        fail ("open or malloc failed");
+    }
+}
+
+/* Fills the buffer with VALUE and hands it to the other side
+   through handle OUT. */
+static void
+send (unsigned char value, int out)
+{
+  memset (buf, value, BUF_SIZE);
+  if (fd >= 0)
+    {
+      seek (fd, 0);
+      if (write (fd, buf, BUF_SIZE) != BUF_SIZE)
+        fail ("write failed");
+    }
+  if (write (out, &value, 1) != 1)
+    fail ("write to pipe failed");
+}
+
+/* Waits on handle IN for the other side to hand over the buffer,
+   and checks that each page of it holds the value announced. */
+static void
+receive (int in)
+{
+  unsigned char value;
+  size_t ofs;
+
+  if (read (in, &value, 1) != 1)
+    fail ("read from pipe failed");
+  if (fd >= 0)
+    {
+      seek (fd, 0);
+      if (read (fd, buf, BUF_SIZE) != BUF_SIZE)
+        fail ("read failed");
+    }
+  for (ofs = 0; ofs < BUF_SIZE; ofs += 4096)
+    if (buf[ofs] != value || buf[ofs + 4095] != value)
+      fail ("buffer holds %d instead of %d", buf[ofs], value);
+}
+
+/* Child side: answers each turn on standard input by sending
+   the buffer back on standard output with the next value. */
+static void
+child (bool shm)
+{
+  int i;
+
+  open_buffer (shm, false);
+  for (i = 0; i < ROUNDS; i++)
+    {
+      receive (STDIN_FILENO);
+      send (i * 2 + 2, STDOUT_FILENO);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  int to_child[2], to_parent[2];
+  int saved_in, saved_out;
+  bool shm;
+  pid_t pid;
+  int i;
+
+  test_name = "shm-pingpong";
+  if (argc < 2 || (strcmp (argv[1], "shm") && strcmp (argv[1], "file")))
+    fail ("usage: shm-pingpong shm|file");
+  shm = !strcmp (argv[1], "shm");
+  if (argc > 2)
+    {
+      child (shm);
+      return 0;
+    }
+
+  msg ("begin");
+  open_buffer (shm, true);
+
+  /* Run the child with its standard input and output connected
+     to this process through pipes. */
+  if (!pipe (to_child) || !pipe (to_parent))
+    fail ("pipe failed");
+  saved_in = dup (STDIN_FILENO);
+  saved_out = dup (STDOUT_FILENO);
+  dup2 (to_child[0], STDIN_FILENO);
+  dup2 (to_parent[1], STDOUT_FILENO);
+  pid = exec (shm ? "shm-pingpong shm child" : "shm-pingpong file child");
+  dup2 (saved_in, STDIN_FILENO);
+  dup2 (saved_out, STDOUT_FILENO);
+  close (saved_in);
+  close (saved_out);
+  close (to_child[0]);
+  close (to_parent[1]);
+  if (pid == PID_ERROR)
+    fail ("exec failed");
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      send (i * 2 + 1, to_child[1]);
+      receive (to_parent[0]);
+    }
+  if (wait (pid) != 0)
+    fail ("child failed");
+  msg ("%d round trips of %d kB through %s", ROUNDS, BUF_SIZE / 1024,
+       shm ? "shared memory" : "a file");
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,31 @@
+/* Creates a shared memory segment and runs a child that
+   attaches it at a different address and changes it, then
+   checks that the change shows through, that the segment is
+   released on its last detach, and that a segment the child
+   created but never attached went away when the child exited. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Where this process attaches the segment.
+   child-shm attaches it elsewhere. */
+#define SHM_BASE ((char *) 0x10000000)
+
+void
+test_main (void) 
+{
+  CHECK (shm_create ("shm-share", 2), "create \"shm-share\"");
+  CHECK (!shm_create ("shm-share", 1), "create \"shm-share\" again (must fail)");
+  CHECK (shm_attach ("shm-share", SHM_BASE) == SHM_BASE, "attach segment");
+  strlcpy (SHM_BASE + 4096, "parent", 16);
+  CHECK (wait (exec ("child-shm")) == 0, "wait for child");
+  if (strcmp (SHM_BASE + 4096, "child"))
+    fail ("segment holds \"%s\" instead of \"child\"", SHM_BASE + 4096);
+  msg ("saw child's change");
+  CHECK (shm_create ("shm-unused", 1), "create \"shm-unused\"");
+  CHECK (shm_detach (SHM_BASE), "detach segment");
+  CHECK (shm_attach ("shm-share", SHM_BASE) == NULL,
+         "attach released segment (must fail)");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-share) begin
+(shm-share) create "shm-share"
+(shm-share) create "shm-share" again (must fail)
+(shm-share) attach segment
+(shm-share) wait for child
+child-shm: exit(0)
+(shm-share) saw child's change
+(shm-share) create "shm-unused"
+(shm-share) detach segment
+(shm-share) attach released segment (must fail)
+(shm-share) end
+shm-share: exit(0)
+EOF
+pass;
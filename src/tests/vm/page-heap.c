@@ -0,0 +1,115 @@
+/* Allocates about 2 MB of heap in blocks of many sizes, frees
+   and reallocates some of them, and verifies that every block
+   keeps its contents.  Then checks that the heap can be shrunk
+   back with sbrk(), and that growing it again yields zeroed
+   memory rather than the old contents. */
+
+#include <round.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 512
+
+static char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+/* Returns the size to use for block I: mostly small, with every
+   eighth block large. */
+static size_t
+block_size (size_t i)
+{
+  return i % 8 == 0 ? 16 * 1024 + i * 13 : 1 + i * 7 % 1000;
+}
+
+/* Fails unless block I holds its expected contents. */
+static void
+check_block (size_t i)
+{
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    if (blocks[i][j] != (char) (i + j))
+      fail ("block %zu byte %zu is %d", i, j, blocks[i][j]);
+}
+
+/* Allocates block I with SIZE bytes and fills it. */
+static void
+fill_block (size_t i, size_t size)
+{
+  size_t j;
+
+  blocks[i] = malloc (size);
+  if (blocks[i] == NULL)
+    fail ("malloc of %zu bytes failed", size);
+  if ((uintptr_t) blocks[i] % sizeof (uint32_t) != 0)
+    fail ("block %zu is misaligned", i);
+  sizes[i] = size;
+  for (j = 0; j < size; j++)
+    blocks[i][j] = i + j;
+}
+
+void
+test_main (void)
+{
+  char *heap_start = sbrk (0);
+  char *heap_end, *p;
+  size_t i;
+
+  msg ("allocate");
+  for (i = 0; i < BLOCK_CNT; i++)
+    fill_block (i, block_size (i));
+  if ((char *) sbrk (0) <= heap_start)
+    fail ("heap did not grow");
+
+  msg ("free half");
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    {
+      check_block (i);
+      free (blocks[i]);
+    }
+
+  msg ("reallocate");
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    fill_block (i, block_size (BLOCK_CNT - 1 - i));
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    {
+      size_t j, old_size = sizes[i];
+
+      blocks[i] = realloc (blocks[i], old_size * 2);
+      if (blocks[i] == NULL)
+        fail ("realloc of block %zu failed", i);
+      check_block (i);
+      sizes[i] *= 2;
+      for (j = old_size; j < sizes[i]; j++)
+        blocks[i][j] = i + j;
+    }
+
+  msg ("verify");
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      check_block (i);
+      free (blocks[i]);
+    }
+
+  msg ("shrink");
+  heap_end = sbrk (0);
+  if (sbrk (heap_start - (char *) sbrk (0)) == (void *) -1)
+    fail ("sbrk could not shrink the heap");
+  if (sbrk (0) != heap_start)
+    fail ("heap did not shrink to its start");
+  if (sbrk (-1) != (void *) -1)
+    fail ("sbrk shrank the heap below its start");
+
+  /* The page that holds the start of the heap stayed mapped, so
+     only the pages after it must read back as zeros. */
+  msg ("regrow");
+  if (sbrk (heap_end - heap_start) != heap_start)
+    fail ("sbrk could not grow the heap again");
+  for (p = (char *) ROUND_UP ((uintptr_t) heap_start, 4096); p < heap_end; p++)
+    if (*p != 0)
+      fail ("regrown heap byte %p is %d", p, *p);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-heap) begin
+(page-heap) allocate
+(page-heap) free half
+(page-heap) reallocate
+(page-heap) verify
+(page-heap) shrink
+(page-heap) regrow
+(page-heap) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Touches 1 MB of memory while the kernel limits each process
+   to SOFT_LIMIT resident pages normally and HARD_LIMIT pages at
+   most, as set on the kernel command line, and checks that the
+   process stays within its hard limit and its memory keeps its
+   contents. */
+
+#include <memusage.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SOFT_LIMIT 64
+#define HARD_LIMIT 128
+#define PAGE_CNT 256
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  struct memusage u;
+  size_t i;
+
+  msg ("write");
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+
+  msg ("check usage");
+  CHECK (memusage (&u), "memusage");
+  if (u.soft_limit != SOFT_LIMIT || u.hard_limit != HARD_LIMIT)
+    fail ("limits are %zu and %zu, expected %d and %d",
+          u.soft_limit, u.hard_limit, SOFT_LIMIT, HARD_LIMIT);
+  if (u.resident == 0 || u.resident > HARD_LIMIT)
+    fail ("%zu pages resident, limit is %d", u.resident, HARD_LIMIT);
+  if (u.evictions == 0)
+    fail ("no pages were evicted");
+  if (u.faults < PAGE_CNT)
+    fail ("only %lu page faults for %d pages", u.faults, PAGE_CNT);
+
+  msg ("read");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * PAGE_SIZE] != (char) i)
+      fail ("page %zu has the wrong contents", i);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-rss) begin
+(page-rss) write
+(page-rss) check usage
+(page-rss) memusage
+(page-rss) read
+(page-rss) end
+EOF
+pass;
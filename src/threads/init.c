@@ -22,6 +22,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -31,6 +32,14 @@
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/page.h"
+#include "vm/policy.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -57,6 +66,11 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef USERPROG
+/* -lp: Number of 4 MB large pages to set aside for user heaps. */
+static size_t user_large_pages;
+#endif
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -92,12 +106,22 @@ main (void)
 
   /* Greet user. */
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
-          init_ram_pages * PGSIZE / 1024);
+          (init_ram_pages + init_high_pages) * PGSIZE / 1024);
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
+#ifdef USERPROG
+  if (user_large_pages > 0)
+    palloc_reserve_large (user_large_pages);
+#endif
   malloc_init ();
   paging_init ();
+  vmalloc_init ();
+#ifdef VM
+  frame_init ();
+  page_init ();
+  ksm_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -118,6 +142,7 @@ main (void)
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
+  console_start ();
   timer_calibrate ();
 
 #ifdef FILESYS
@@ -127,6 +152,13 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap and start sampling page accesses. */
+  swap_init ();
+  frame_start ();
+  ksm_start ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -150,16 +182,38 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* CPUID feature bit (in EDX) and CR4 bit for 4 MB pages. */
+#define CPUID_PSE 0x00000008
+#define CR4_PSE 0x00000010
+
+/* Returns true if the CPU supports 4 MB large pages. */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  /* See [IA32-v2a] "CPUID--CPU Identification". */
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   Where the CPU allows it, each 4 MB of RAM that is entirely
+   present and holds no kernel text is mapped with a single
+   large page, so that the whole direct map takes only a few
+   TLB entries.  Kernel text stays in 4 kB pages so that it can
+   be mapped read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  bool pse = cpu_has_pse ();
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,6 +225,14 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true, false);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -180,6 +242,14 @@ paging_init (void)
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
     }
 
+  /* Large pages must be enabled before they are used. */
+  if (pse)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -256,9 +326,38 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-baud"))
+        {
+          if (value == NULL || !serial_set_rate (atoi (value)))
+            PANIC ("unsupported serial rate `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-lp"))
+        user_large_pages = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-fa"))
+        fault_around_pages = atoi (value);
+      else if (!strcmp (name, "-ksm"))
+        ksm_pages_per_sec = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-rss"))
+        {
+          char *hard = value != NULL ? strchr (value, ',') : NULL;
+          rss_soft_limit = atoi (value);
+          if (hard != NULL)
+            rss_hard_limit = atoi (hard + 1);
+        }
+      else if (!strcmp (name, "-evict"))
+        {
+          if (!frame_policy_select (value))
+            PANIC ("unknown replacement policy `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -379,8 +478,17 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -baud=BPS          Run serial port at BPS (default 115200).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -lp=COUNT          Set aside COUNT 4 MB pages for user heaps.\n"
+#endif
+#ifdef VM
+          "  -fa=COUNT          Map up to COUNT pages around page faults.\n"
+          "  -ksm=RATE          Merge identical user pages, scanning RATE/s.\n"
+          "  -evict=POLICY      Evict pages by POLICY: clock, aging, or 2q.\n"
+          "  -zswap=COUNT       Compress swapped pages into COUNT kernel pages.\n"
+          "  -rss=SOFT[,HARD]   Limit each process's resident pages.\n"
 #endif
           );
   shutdown_power_off ();
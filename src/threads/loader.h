@@ -33,8 +33,12 @@
 #ifndef __ASSEMBLER__
 #include <stdint.h>
 
-/* Amount of physical memory, in 4 kB pages. */
+/* Amount of physical memory mapped into kernel virtual memory,
+   in 4 kB pages. */
 extern uint32_t init_ram_pages;
+
+/* Amount of physical memory above that, in 4 kB pages. */
+extern uint32_t init_high_pages;
 #endif
 
 #endif /* threads/loader.h */
@@ -8,6 +8,7 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/vmalloc.h"
 
 /* A simple implementation of malloc().
 
@@ -30,9 +31,11 @@
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   descriptor.  We handle those by allocating virtually
+   contiguous pages with vmalloc(), or contiguous pages from the
+   page allocator early in boot, and sticking the allocation
+   size at the beginning of the allocated block's arena
+   header. */
 
 /* Descriptor. */
 struct desc
@@ -107,7 +110,9 @@ malloc (size_t size)
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
+      a = vmalloc (page_cnt * PGSIZE, 0);
+      if (a == NULL)
+        a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
 
@@ -257,7 +262,10 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
+          if (is_vmalloc_vaddr (a))
+            vfree (a);
+          else
+            palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
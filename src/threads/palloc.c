@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -23,7 +24,11 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   On request, some of the user pool is set aside at startup as
+   4 MB large pages, which must be physically contiguous and
+   aligned, and so are hard to find once memory is in use. */
 
 /* A memory pool. */
 struct pool
@@ -36,6 +41,13 @@ struct pool
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Free large pages, set aside from the user pool.
+   Protected by the user pool's lock. */
+#define LARGE_MAX 16
+#define LARGE_PAGES (PTSPAN / PGSIZE)
+static void *large_pages[LARGE_MAX];
+static size_t large_free_cnt;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
@@ -141,6 +153,74 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
 }
 
+/* Sets aside up to CNT large pages from the user pool for use
+   with palloc_get_large().  Returns the number set aside. */
+size_t
+palloc_reserve_large (size_t cnt)
+{
+  size_t pool_pages = bitmap_size (user_pool.used_map);
+  size_t base_pfn = vtop (user_pool.base) / PGSIZE;
+  size_t idx;
+
+  lock_acquire (&user_pool.lock);
+  for (idx = (LARGE_PAGES - base_pfn % LARGE_PAGES) % LARGE_PAGES;
+       idx + LARGE_PAGES <= pool_pages && large_free_cnt < LARGE_MAX
+         && large_free_cnt < cnt;
+       idx += LARGE_PAGES)
+    if (bitmap_none (user_pool.used_map, idx, LARGE_PAGES))
+      {
+        bitmap_set_multiple (user_pool.used_map, idx, LARGE_PAGES, true);
+        large_pages[large_free_cnt++] = user_pool.base + idx * PGSIZE;
+      }
+  lock_release (&user_pool.lock);
+
+  printf ("%zu large pages set aside from user pool.\n", large_free_cnt);
+  return large_free_cnt;
+}
+
+/* Obtains a 4 MB large page set aside by palloc_reserve_large()
+   and returns its kernel virtual address.  If PAL_ZERO is set
+   in FLAGS, the page is filled with zeros.  If none is free,
+   returns a null pointer, unless PAL_ASSERT is set in FLAGS, in
+   which case the kernel panics. */
+void *
+palloc_get_large (enum palloc_flags flags)
+{
+  void *page = NULL;
+
+  lock_acquire (&user_pool.lock);
+  if (large_free_cnt > 0)
+    page = large_pages[--large_free_cnt];
+  lock_release (&user_pool.lock);
+
+  if (page != NULL)
+    {
+      if (flags & PAL_ZERO)
+        memset (page, 0, PTSPAN);
+    }
+  else if (flags & PAL_ASSERT)
+    PANIC ("palloc_get_large: out of large pages");
+  return page;
+}
+
+/* Returns large page PAGE, obtained with palloc_get_large(), to
+   the set of free large pages. */
+void
+palloc_free_large (void *page)
+{
+  ASSERT (((uintptr_t) page & (PTSPAN - 1)) == 0);
+  ASSERT (page_from_pool (&user_pool, page));
+
+#ifndef NDEBUG
+  memset (page, 0xcc, PTSPAN);
+#endif
+
+  lock_acquire (&user_pool.lock);
+  ASSERT (large_free_cnt < LARGE_MAX);
+  large_pages[large_free_cnt++] = page;
+  lock_release (&user_pool.lock);
+}
+
 /* Frees the page at PAGE. */
 void
 palloc_free_page (void *page) 
@@ -17,4 +17,8 @@ void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
 
+size_t palloc_reserve_large (size_t cnt);
+void *palloc_get_large (enum palloc_flags);
+void palloc_free_large (void *);
+
 #endif /* threads/palloc.h */
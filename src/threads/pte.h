@@ -51,7 +51,10 @@ static inline uintptr_t pd_no (const void *va) {
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, unless
+   the PDE has the PTE_PS bit set, in which case it maps a whole
+   4 MB large page directly.  The physical address of a large
+   page must be a multiple of 4 MB.
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -66,6 +69,10 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB large page (PDEs only). */
+
+/* Address bits of a large-page PDE. */
+#define PDE_LARGE_ADDR 0xffc00000
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -77,16 +84,51 @@ static inline uint32_t pde_create (uint32_t *pt) {
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns true if PDE maps a large page, false if it points to
+   a page table or is not present. */
+static inline bool pde_is_large (uint32_t pde) {
+  return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* Returns a PDE that maps the 4 MB large page at PAGE.
+   The page is readable.
+   If WRITABLE is true then it will be writable as well.
+   If USER is true then it will be usable by user code too. */
+static inline uint32_t pde_create_large (void *page, bool writable,
+                                         bool user) {
+  ASSERT ((vtop (page) & ~PDE_LARGE_ADDR) == 0);
+  return (vtop (page) | PTE_P | PTE_PS | (writable ? PTE_W : 0)
+          | (user ? PTE_U : 0));
+}
+
+/* Returns a pointer to the large page that PDE maps. */
+static inline void *pde_get_large (uint32_t pde) {
+  ASSERT (pde_is_large (pde));
+  return ptov (pde & PDE_LARGE_ADDR);
+}
+
+/* Returns a PTE that points to the page at physical address
+   PADDR, which need not be in the kernel's direct map.
+   The PTE's page is readable.
+   If WRITABLE is true then it will be writable as well.
+   If USER is true then it will be usable by user code too. */
+static inline uint32_t pte_create_paddr (uintptr_t paddr, bool writable,
+                                         bool user) {
+  ASSERT ((paddr & PGMASK) == 0);
+  return paddr | PTE_P | (writable ? PTE_W : 0) | (user ? PTE_U : 0);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
    The page will be usable only by ring 0 code (the kernel). */
 static inline uint32_t pte_create_kernel (void *page, bool writable) {
   ASSERT (pg_ofs (page) == 0);
-  return vtop (page) | PTE_P | (writable ? PTE_W : 0);
+  return pte_create_paddr (vtop (page), writable, false);
 }
 
 /* Returns a PTE that points to PAGE.
@@ -97,7 +97,6 @@ thread_init (void)
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
-  initial_thread->tid_name = "main";
   initial_thread->tid = allocate_tid ();
 }
 
@@ -464,6 +463,12 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
+#ifdef USERPROG
+  list_init (&t->children);
+  t->next_handle = 2;
+  list_init (&t->mappings);
+  list_init (&t->shm_attachments);
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* States in a thread's life cycle. */
@@ -96,12 +97,38 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct file *bin_file;              /* Executable, denied writes. */
+    void *heap_start;                   /* Start of heap. */
+    void *brk;                          /* End of heap. */
+    struct wait_status *wait_status;    /* This process's completion state. */
+    struct list children;               /* Completion state of children. */
+
+    /* Owned by userprog/syscall.c. */
+    struct fd *fds;                     /* File descriptors, by handle. */
+    struct bitmap *fd_map;              /* Handles in use. */
+    int next_handle;                    /* Next mapping id. */
+    struct list mappings;               /* Memory-mapped files. */
+
+    /* Owned by userprog/ring.c. */
+    struct ring *ring;                  /* I/O rings, if any. */
+
+    /* Owned by userprog/shm.c. */
+    struct list shm_attachments;        /* Attached shared memory. */
+#endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Page table. */
+    void *fault_next;                   /* Next page of a sequential scan. */
+    size_t fault_window;                /* Current fault-around window. */
+    unsigned long fault_cnt;            /* Pages brought in by faults. */
+
+    /* Owned by vm/frame.c. */
+    size_t ws_pages;                    /* Working-set size estimate. */
+    size_t rss_pages;                   /* Resident pages. */
+    size_t rss_soft;                    /* Soft resident limit, or 0. */
+    size_t rss_hard;                    /* Hard resident limit, or 0. */
+    unsigned long evict_cnt;            /* Pages evicted. */
 #endif
-
-    /* Added by student */
-    char *tid_name;
-
-    /*End Added by Student */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
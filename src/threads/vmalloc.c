@@ -0,0 +1,209 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Virtually contiguous kernel allocations.
+
+   palloc_get_multiple() can only return pages that are
+   physically contiguous, which become scarce as the kernel pool
+   fragments.  vmalloc() instead gathers single pages from
+   wherever they are free and maps them side by side in the
+   "vmalloc area", a range of kernel virtual memory just above
+   the direct map of physical memory.
+
+   The area's page tables are created at boot, before any
+   process exists, so every page directory shares them and sees
+   a mapping as soon as it is made.  Each allocation is followed
+   by an unmapped guard page, which both catches overruns and
+   marks the allocation's end for vfree().
+
+   Memory from vmalloc() is not in the direct map, so vtop()
+   does not work on it.
+
+   The same area also provides temporary mappings, with kmap(),
+   of pages of high memory, which lie beyond the direct map. */
+
+/* Size of the vmalloc area, in pages. */
+#define VMALLOC_PAGES (64 * 1024 * 1024 / PGSIZE)
+
+/* Start of the vmalloc area. */
+static uint8_t *vmalloc_start;
+
+/* Page table entries for the vmalloc area, in order.  The page
+   tables are consecutive in the kernel pool, so this is one
+   array. */
+static uint32_t *vmalloc_ptes;
+
+/* Pages of the vmalloc area in use, counting guard pages. */
+static struct bitmap *used_map;
+static struct lock vmalloc_lock;
+
+/* Invalidates the TLB entry for VADDR. */
+static inline void
+invlpg (const void *vaddr)
+{
+  asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
+
+/* Sets up the vmalloc area, leaving a 4 MB gap after the direct
+   map.  Must be called after paging_init() and before any page
+   directory is created. */
+void
+vmalloc_init (void)
+{
+  size_t pt_cnt = DIV_ROUND_UP (VMALLOC_PAGES, PGSIZE / sizeof (uint32_t));
+  size_t i;
+
+  vmalloc_start = ((uint8_t *) ROUND_UP ((uintptr_t) ptov (0)
+                                         + init_ram_pages * PGSIZE, PTSPAN)
+                   + PTSPAN);
+  ASSERT (pd_no (vmalloc_start + VMALLOC_PAGES * PGSIZE - 1)
+          < PGSIZE / sizeof (uint32_t) - 1);
+
+  vmalloc_ptes = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, pt_cnt);
+  for (i = 0; i < pt_cnt; i++)
+    init_page_dir[pd_no (vmalloc_start) + i]
+      = pde_create (vmalloc_ptes + i * (PGSIZE / sizeof (uint32_t)));
+
+  used_map = bitmap_create (VMALLOC_PAGES);
+  if (used_map == NULL)
+    PANIC ("couldn't create vmalloc bitmap");
+  lock_init (&vmalloc_lock);
+}
+
+/* Frees the pages mapped at PAGE_CNT consecutive entries of the
+   vmalloc area starting at IDX and unmaps them. */
+static void
+unmap_pages (size_t idx, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = idx; i < idx + page_cnt; i++)
+    {
+      palloc_free_page (pte_get_page (vmalloc_ptes[i]));
+      vmalloc_ptes[i] = 0;
+      invlpg (vmalloc_start + i * PGSIZE);
+    }
+}
+
+/* Obtains SIZE bytes of virtually contiguous kernel memory,
+   rounded up to whole pages, and returns its start.  FLAGS are
+   as for palloc_get_page(), except that PAL_USER is not
+   allowed.  Returns a null pointer if no memory is available,
+   or if called before vmalloc_init(). */
+void *
+vmalloc (size_t size, enum palloc_flags flags)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  size_t idx, i;
+
+  ASSERT ((flags & PAL_USER) == 0);
+
+  if (used_map == NULL || page_cnt == 0)
+    goto fail;
+
+  lock_acquire (&vmalloc_lock);
+  idx = bitmap_scan_and_flip (used_map, 0, page_cnt + 1, false);
+  lock_release (&vmalloc_lock);
+  if (idx == BITMAP_ERROR)
+    goto fail;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      void *page = palloc_get_page (flags & PAL_ZERO);
+      if (page == NULL)
+        {
+          unmap_pages (idx, i);
+          lock_acquire (&vmalloc_lock);
+          bitmap_set_multiple (used_map, idx, page_cnt + 1, false);
+          lock_release (&vmalloc_lock);
+          goto fail;
+        }
+      vmalloc_ptes[idx + i] = pte_create_kernel (page, true);
+    }
+  return vmalloc_start + idx * PGSIZE;
+
+ fail:
+  if (flags & PAL_ASSERT)
+    PANIC ("vmalloc: out of pages");
+  return NULL;
+}
+
+/* Frees memory obtained from vmalloc().  Does nothing if VADDR
+   is a null pointer. */
+void
+vfree (void *vaddr)
+{
+  size_t idx, page_cnt;
+
+  if (vaddr == NULL)
+    return;
+
+  ASSERT (is_vmalloc_vaddr (vaddr));
+  ASSERT (pg_ofs (vaddr) == 0);
+  idx = pg_no (vaddr) - pg_no (vmalloc_start);
+  for (page_cnt = 0; vmalloc_ptes[idx + page_cnt] & PTE_P; page_cnt++)
+    continue;
+  ASSERT (page_cnt > 0);
+
+  unmap_pages (idx, page_cnt);
+  lock_acquire (&vmalloc_lock);
+  ASSERT (bitmap_all (used_map, idx, page_cnt + 1));
+  bitmap_set_multiple (used_map, idx, page_cnt + 1, false);
+  lock_release (&vmalloc_lock);
+}
+
+/* Returns a kernel virtual address for the page at physical
+   address PADDR.  If the page lies beyond the direct map, it is
+   mapped temporarily, until kunmap(). */
+void *
+kmap (uintptr_t paddr)
+{
+  size_t idx;
+
+  ASSERT ((paddr & PGMASK) == 0);
+  if (paddr >> PGBITS < init_ram_pages)
+    return ptov (paddr);
+
+  lock_acquire (&vmalloc_lock);
+  idx = bitmap_scan_and_flip (used_map, 0, 1, false);
+  lock_release (&vmalloc_lock);
+  if (idx == BITMAP_ERROR)
+    PANIC ("kmap: vmalloc area is full");
+
+  vmalloc_ptes[idx] = pte_create_paddr (paddr, true, false);
+  return vmalloc_start + idx * PGSIZE;
+}
+
+/* Releases kernel virtual address VADDR, obtained from kmap(). */
+void
+kunmap (void *vaddr)
+{
+  size_t idx;
+
+  if (!is_vmalloc_vaddr (vaddr))
+    return;
+
+  idx = pg_no (vaddr) - pg_no (vmalloc_start);
+  vmalloc_ptes[idx] = 0;
+  invlpg (vaddr);
+  lock_acquire (&vmalloc_lock);
+  bitmap_reset (used_map, idx);
+  lock_release (&vmalloc_lock);
+}
+
+/* Returns true if VADDR lies in the vmalloc area. */
+bool
+is_vmalloc_vaddr (const void *vaddr)
+{
+  return (vmalloc_start != NULL
+          && (uint8_t *) vaddr >= vmalloc_start
+          && (uint8_t *) vaddr < vmalloc_start + VMALLOC_PAGES * PGSIZE);
+}
@@ -0,0 +1,17 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+
+void vmalloc_init (void);
+void *vmalloc (size_t size, enum palloc_flags);
+void vfree (void *);
+bool is_vmalloc_vaddr (const void *);
+
+void *kmap (uintptr_t paddr);
+void kunmap (void *);
+
+#endif /* threads/vmalloc.h */
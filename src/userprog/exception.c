@@ -2,8 +2,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,9 +153,20 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* Bring in the page to which FAULT_ADDR refers, if any.  A
+     write to a page that is mapped read-only may be the first
+     write to a zero-fill page, which also needs a new frame. */
+  if (is_user_vaddr (fault_addr) && page_in (fault_addr, write))
+    return;
+#endif
+
+  /* A kernel access to user memory through one of the functions
+     in uaccess.c resumes at its fixup code, which reports the
+     error to its caller. */
+  if (!user && uaccess_fixup (f))
+    return;
+
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
@@ -3,12 +3,49 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
-static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
 
+/* The last directory entry would map the top 4 MB of kernel
+   virtual memory, which lies far above the end of physical
+   memory, so it is never present.  Instead, it records the
+   range of user directory entries that have ever been filled
+   in, as PD_META_LO (the first) and PD_META_HI (one past the
+   last), with the present bit clear.  pagedir_destroy() visits
+   only this range. */
+#define PD_META (PGSIZE / sizeof (uint32_t) - 1)
+#define PD_META_LO(M) (((M) >> 2) & 0x3ff)
+#define PD_META_HI(M) (((M) >> 12) & 0x3ff)
+
+/* Page directories kept ready for reuse, with the kernel half
+   copied from init_page_dir and the user half empty. */
+#define PD_POOL_SIZE 4
+static uint32_t *pd_pool[PD_POOL_SIZE];
+static size_t pd_pool_cnt;
+
+/* Records that PD's user directory entry PDE_IDX is in use. */
+static void
+note_pde (uint32_t *pd, size_t pde_idx) 
+{
+  uint32_t meta = pd[PD_META];
+  size_t lo = PD_META_LO (meta);
+  size_t hi = PD_META_HI (meta);
+
+  if (lo >= hi)
+    {
+      lo = pde_idx;
+      hi = pde_idx + 1;
+    }
+  else if (pde_idx < lo)
+    lo = pde_idx;
+  else if (pde_idx >= hi)
+    hi = pde_idx + 1;
+  pd[PD_META] = (lo << 2) | (hi << 12);
+}
+
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
@@ -16,7 +53,18 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (pd_pool_cnt > 0)
+    pd = pd_pool[--pd_pool_cnt];
+  intr_set_level (old_level);
+  if (pd != NULL)
+    return pd;
+
+  ASSERT (init_page_dir[PD_META] == 0);
+  pd = palloc_get_page (0);
   if (pd != NULL)
     memcpy (pd, init_page_dir, PGSIZE);
   return pd;
@@ -27,24 +75,44 @@ pagedir_create (void)
 void
 pagedir_destroy (uint32_t *pd) 
 {
-  uint32_t *pde;
+  uint32_t *pde, *lo, *hi;
+  enum intr_level old_level;
 
   if (pd == NULL)
     return;
 
   ASSERT (pd != init_page_dir);
-  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
-      {
-        uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
+  lo = pd + PD_META_LO (pd[PD_META]);
+  hi = pd + PD_META_HI (pd[PD_META]);
+  for (pde = lo; pde < hi; pde++)
+    {
+      if (pde_is_large (*pde))
+        palloc_free_large (pde_get_large (*pde));
+      else if (*pde & PTE_P) 
+        {
+          uint32_t *pt = pde_get_pt (*pde);
+          uint32_t *pte;
         
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
-        palloc_free_page (pt);
-      }
-  palloc_free_page (pd);
+          for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+            if (*pte & PTE_P) 
+              palloc_free_page (pte_get_page (*pte));
+          palloc_free_page (pt);
+        }
+      *pde = 0;
+    }
+  pd[PD_META] = 0;
+
+  /* The user half is empty again, so keep PD for reuse if there
+     is room. */
+  old_level = intr_disable ();
+  if (pd_pool_cnt < PD_POOL_SIZE)
+    {
+      pd_pool[pd_pool_cnt++] = pd;
+      pd = NULL;
+    }
+  intr_set_level (old_level);
+  if (pd != NULL)
+    palloc_free_page (pd);
 }
 
 /* Returns the address of the page table entry for virtual
@@ -52,7 +120,9 @@ pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   VADDR must not be mapped by a large page if CREATE is true;
+   otherwise a null pointer is returned in that case too. */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -66,6 +136,11 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no (vaddr);
+  if (pde_is_large (*pde))
+    {
+      ASSERT (!create);
+      return NULL;
+    }
   if (*pde == 0) 
     {
       if (create)
@@ -75,6 +150,7 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
             return NULL; 
       
           *pde = pde_create (pt);
+          note_pde (pd, pd_no (vaddr));
         }
       else
         return NULL;
@@ -97,13 +173,24 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
    failed. */
 bool
 pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
+
+  return pagedir_set_paddr (pd, upage, vtop (kpage), writable);
+}
+
+/* Like pagedir_set_page(), but maps UPAGE to the page at
+   physical address PADDR, which may lie in high memory. */
+bool
+pagedir_set_paddr (uint32_t *pd, void *upage, uintptr_t paddr,
+                   bool writable)
 {
   uint32_t *pte;
 
   ASSERT (pg_ofs (upage) == 0);
-  ASSERT (pg_ofs (kpage) == 0);
   ASSERT (is_user_vaddr (upage));
-  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
+  ASSERT (paddr >> PTSHIFT < init_ram_pages + init_high_pages);
   ASSERT (pd != init_page_dir);
 
   pte = lookup_page (pd, upage, true);
@@ -111,7 +198,7 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
   if (pte != NULL) 
     {
       ASSERT ((*pte & PTE_P) == 0);
-      *pte = pte_create_user (kpage, writable);
+      *pte = pte_create_paddr (paddr, writable, true);
       return true;
     }
   else
@@ -121,16 +208,21 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
-   UADDR is unmapped. */
+   UADDR is unmapped or mapped to high memory. */
 void *
 pagedir_get_page (uint32_t *pd, const void *uaddr) 
 {
   uint32_t *pte;
 
   ASSERT (is_user_vaddr (uaddr));
+
+  if (pde_is_large (pd[pd_no (uaddr)]))
+    return ((uint8_t *) pde_get_large (pd[pd_no (uaddr)])
+            + ((uintptr_t) uaddr & ~PDE_LARGE_ADDR));
   
   pte = lookup_page (pd, uaddr, false);
-  if (pte != NULL && (*pte & PTE_P) != 0)
+  if (pte != NULL && (*pte & PTE_P) != 0
+      && (*pte & PTE_ADDR) >> PTSHIFT < init_ram_pages)
     return pte_get_page (*pte) + pg_ofs (uaddr);
   else
     return NULL;
@@ -156,6 +248,60 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Maps the 4 MB of user virtual memory starting at UPAGE, which
+   must be aligned to 4 MB and entirely unmapped, to large page
+   KPAGE, obtained from palloc_get_large().  If WRITABLE is true,
+   the mapping is read/write; otherwise it is read-only.
+   KPAGE is freed along with PD, if it is still mapped then. */
+void
+pagedir_set_large (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pde = pd + pd_no (upage);
+
+  ASSERT (((uintptr_t) upage & ~PDE_LARGE_ADDR) == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (pd != init_page_dir);
+  ASSERT (*pde == 0);
+
+  *pde = pde_create_large (kpage, writable, true);
+  note_pde (pd, pd_no (upage));
+}
+
+/* Returns the kernel virtual address of the large page that
+   maps user virtual address UADDR in PD, or a null pointer if
+   UADDR is not mapped by a large page. */
+void *
+pagedir_get_large (uint32_t *pd, const void *uaddr)
+{
+  uint32_t pde = pd[pd_no (uaddr)];
+
+  ASSERT (is_user_vaddr (uaddr));
+  return pde_is_large (pde) ? pde_get_large (pde) : NULL;
+}
+
+/* Returns true if PD has neither a page table nor a large page
+   for the 4 MB of user virtual memory that contains UADDR. */
+bool
+pagedir_span_is_empty (uint32_t *pd, const void *uaddr)
+{
+  ASSERT (is_user_vaddr (uaddr));
+  return pd[pd_no (uaddr)] == 0;
+}
+
+/* Removes the large page mapping that covers user virtual
+   address UADDR in PD, which must exist, and returns the large
+   page, which the caller must free. */
+void *
+pagedir_clear_large (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pde = pd + pd_no (uaddr);
+  void *kpage = pde_get_large (*pde);
+
+  *pde = 0;
+  invalidate_pagedir (pd);
+  return kpage;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -231,8 +377,8 @@ pagedir_activate (uint32_t *pd)
 }
 
 /* Returns the currently active page directory. */
-static uint32_t *
-active_pd (void) 
+uint32_t *
+pagedir_active (void) 
 {
   /* Copy CR3, the page directory base register (PDBR), into
      `pd'.
@@ -254,7 +400,7 @@ active_pd (void)
 static void
 invalidate_pagedir (uint32_t *pd) 
 {
-  if (active_pd () == pd) 
+  if (pagedir_active () == pd) 
     {
       /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
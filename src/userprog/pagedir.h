@@ -7,12 +7,18 @@
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_paddr (uint32_t *pd, void *upage, uintptr_t paddr, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+void pagedir_set_large (uint32_t *pd, void *upage, void *kpage, bool rw);
+void *pagedir_get_large (uint32_t *pd, const void *uaddr);
+void *pagedir_clear_large (uint32_t *pd, const void *uaddr);
+bool pagedir_span_is_empty (uint32_t *pd, const void *uaddr);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
 void pagedir_activate (uint32_t *pd);
+uint32_t *pagedir_active (void);
 
 #endif /* userprog/pagedir.h */
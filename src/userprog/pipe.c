@@ -0,0 +1,215 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Pipes.
+
+   A pipe holds the data written to it in a ring of up to
+   PIPE_BUFS buffers of one page each.  Small writes are copied
+   onto the end of the newest buffer, or into a fresh one.  A
+   write of a whole page instead hands over the caller's page
+   itself as a new buffer, and a read of a whole page takes a
+   full buffer's page in exchange for the caller's, so bulk data
+   passes from writer to reader without being copied inside the
+   kernel.  The pages involved are the kernel bounce pages that
+   the read and write system calls already use (see
+   userprog/syscall.c). */
+
+/* Maximum number of buffers in a pipe. */
+#define PIPE_BUFS 4
+
+/* A buffer of pipe data. */
+struct pipe_buf
+  {
+    uint8_t *page;              /* Page holding the data. */
+    size_t ofs;                 /* Offset of data in PAGE. */
+    size_t len;                 /* Number of bytes of data. */
+  };
+
+/* A pipe. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all members. */
+    struct condition readable;  /* Data arrived or writers left. */
+    struct condition writable;  /* Room freed or readers left. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+    struct pipe_buf bufs[PIPE_BUFS]; /* Ring of buffers. */
+    size_t first;               /* Index of oldest buffer. */
+    size_t cnt;                 /* Number of buffers in use. */
+  };
+
+/* Creates and returns a new, empty pipe with one read end and
+   one write end open, or a null pointer if memory is short. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      lock_init (&p->lock);
+      cond_init (&p->readable);
+      cond_init (&p->writable);
+      p->readers = p->writers = 1;
+      p->first = p->cnt = 0;
+    }
+  return p;
+}
+
+/* Opens another read end of P, or write end if WRITER. */
+void
+pipe_open (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or write end if WRITER, and frees P
+   once both ends are fully closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->readable, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->writable, &p->lock);
+    }
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      for (; p->cnt > 0; p->cnt--, p->first++)
+        palloc_free_page (p->bufs[p->first % PIPE_BUFS].page);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes, at most PGSIZE, from P into the page
+   at *PAGE.  If WAIT is true and P is empty, first waits for
+   data to arrive or for the write ends to be closed.  May
+   replace *PAGE by a different page, which then belongs to the
+   caller, and free the original.
+   Returns the number of bytes read, 0 at end of file. */
+int
+pipe_read (struct pipe *p, uint8_t **page, size_t size, bool wait)
+{
+  size_t bytes_read = 0;
+
+  ASSERT (size <= PGSIZE);
+
+  lock_acquire (&p->lock);
+  while (wait && p->cnt == 0 && p->writers > 0)
+    cond_wait (&p->readable, &p->lock);
+
+  if (p->cnt > 0 && size == PGSIZE
+      && p->bufs[p->first % PIPE_BUFS].len == PGSIZE)
+    {
+      /* Take over a whole page. */
+      palloc_free_page (*page);
+      *page = p->bufs[p->first++ % PIPE_BUFS].page;
+      p->cnt--;
+      bytes_read = PGSIZE;
+    }
+  else
+    while (bytes_read < size && p->cnt > 0)
+      {
+        struct pipe_buf *b = &p->bufs[p->first % PIPE_BUFS];
+        size_t n = b->len < size - bytes_read ? b->len : size - bytes_read;
+
+        memcpy (*page + bytes_read, b->page + b->ofs, n);
+        b->ofs += n;
+        b->len -= n;
+        bytes_read += n;
+        if (b->len == 0)
+          {
+            palloc_free_page (b->page);
+            p->first++;
+            p->cnt--;
+          }
+      }
+
+  if (bytes_read > 0)
+    cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes, at most PGSIZE, from the page at *PAGE to
+   P, waiting for room as necessary.  If SIZE is PGSIZE, may take
+   over the page itself, setting *PAGE to a null pointer.
+   Returns the number of bytes written, which is less than SIZE
+   only if the read ends are closed or memory is short, or -1 if
+   nothing could be written because the read ends are closed. */
+int
+pipe_write (struct pipe *p, uint8_t **page, size_t size)
+{
+  size_t written = 0;
+
+  ASSERT (size <= PGSIZE);
+
+  lock_acquire (&p->lock);
+  while (written < size && p->readers > 0)
+    {
+      struct pipe_buf *last = &p->bufs[(p->first + p->cnt - 1) % PIPE_BUFS];
+      size_t room = p->cnt > 0 ? PGSIZE - (last->ofs + last->len) : 0;
+
+      if (size == PGSIZE && p->cnt < PIPE_BUFS)
+        {
+          /* Hand over the whole page. */
+          struct pipe_buf *b = &p->bufs[(p->first + p->cnt++) % PIPE_BUFS];
+          b->page = *page;
+          b->ofs = 0;
+          b->len = PGSIZE;
+          *page = NULL;
+          written = PGSIZE;
+        }
+      else if (size < PGSIZE && room > 0)
+        {
+          /* Append to the newest buffer. */
+          size_t n = room < size - written ? room : size - written;
+          memcpy (last->page + last->ofs + last->len, *page + written, n);
+          last->len += n;
+          written += n;
+        }
+      else if (size < PGSIZE && p->cnt < PIPE_BUFS)
+        {
+          /* Start a new buffer. */
+          struct pipe_buf *b = &p->bufs[(p->first + p->cnt) % PIPE_BUFS];
+          b->page = palloc_get_page (0);
+          if (b->page == NULL)
+            break;
+          b->ofs = b->len = 0;
+          p->cnt++;
+          continue;
+        }
+      else
+        {
+          cond_wait (&p->writable, &p->lock);
+          continue;
+        }
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  lock_release (&p->lock);
+
+  return written > 0 || size == 0 ? (int) written : -1;
+}
@@ -0,0 +1,14 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, uint8_t **page, size_t size, bool wait);
+int pipe_write (struct pipe *, uint8_t **page, size_t size);
+
+#endif /* userprog/pipe.h */
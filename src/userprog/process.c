@@ -7,50 +7,97 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
+
+/* Context switch statistics. */
+static long long pd_load_cnt;   /* # of page directory loads. */
+static long long pd_keep_cnt;   /* # of TLB flushes avoided. */
+
+/* Data structure shared between process_execute() in the
+   invoking thread and start_process() in the newly invoked
+   thread. */
+struct exec_info
+  {
+    char prog_name[16];                 /* Program to load. */
+    const char *cmd_line;               /* Command line. */
+    size_t cmd_len;                     /* Length of CMD_LINE. */
+    struct thread *parent;              /* Parent process. */
+    struct semaphore load_done;         /* "Up"ed when loading complete. */
+    struct wait_status *wait_status;    /* Child process. */
+    bool success;                       /* Program successfully loaded? */
+  };
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const char *prog_name, const char *cmd_line,
+                  size_t cmd_len, void (**eip) (void), void **esp);
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* Starts a new thread running the user program named by the
+   first word of CMD_LINE, passing it the words of CMD_LINE as
+   arguments, and waits for it to finish loading.  Returns the
+   new process's thread id, or TID_ERROR if CMD_LINE is longer
+   than CMDLINE_MAX, the thread cannot be created, or the program
+   cannot be loaded. */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *cmd_line) 
 {
-  char *fn_copy;
+  struct exec_info exec;
+  const char *prog_name;
+  size_t prog_len;
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  /* Initialize exec_info.  CMD_LINE need not be copied, because
+     we wait for the new thread to finish with it.  The program
+     name is cut short if it is longer than any file name. */
+  exec.cmd_line = cmd_line;
+  exec.parent = thread_current ();
+  exec.cmd_len = strnlen (cmd_line, CMDLINE_MAX + 1);
+  if (exec.cmd_len > CMDLINE_MAX)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  prog_name = cmd_line + strspn (cmd_line, " ");
+  prog_len = strcspn (prog_name, " ");
+  strlcpy (exec.prog_name, prog_name,
+           prog_len < sizeof exec.prog_name
+           ? prog_len + 1 : sizeof exec.prog_name);
+  sema_init (&exec.load_done, 0);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+  /* Create a new thread to execute the program. */
+  tid = thread_create (exec.prog_name, PRI_DEFAULT, start_process, &exec);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&exec.load_done);
+      if (exec.success)
+        list_push_back (&thread_current ()->children,
+                        &exec.wait_status->elem);
+      else
+        tid = TID_ERROR;
+    }
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *exec_)
 {
-  char *file_name = file_name_;
+  struct exec_info *exec = exec_;
+  struct thread *t = thread_current ();
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +106,31 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
-  /* If load failed, quit. */
-  thread_current()->tid_name = (char *)file_name;
-  palloc_free_page (file_name);
+  success = (load (exec->prog_name, exec->cmd_line, exec->cmd_len,
+                   &if_.eip, &if_.esp)
+             && syscall_inherit_fds (exec->parent));
+
+  /* Allocate wait_status. */
+  if (success)
+    {
+      exec->wait_status = t->wait_status
+        = malloc (sizeof *exec->wait_status);
+      success = exec->wait_status != NULL;
+    }
+
+  /* Initialize wait_status. */
+  if (success)
+    {
+      lock_init (&exec->wait_status->lock);
+      exec->wait_status->ref_cnt = 2;
+      exec->wait_status->tid = t->tid;
+      exec->wait_status->exit_code = -1;
+      sema_init (&exec->wait_status->dead, 0);
+    }
+
+  /* Notify parent thread and clean up. */
+  exec->success = success;
+  sema_up (&exec->load_done);
   if (!success) 
     thread_exit ();
 
@@ -76,18 +144,47 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Releases one reference to CS and, if it is now unreferenced,
+   frees it. */
+static void
+release_child (struct wait_status *cs) 
+{
+  int new_ref_cnt;
+  
+  lock_acquire (&cs->lock);
+  new_ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->lock);
+
+  if (new_ref_cnt == 0)
+    free (cs);
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e)) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      if (cs->tid == child_tid) 
+        {
+          int exit_code;
+          list_remove (e);
+          sema_down (&cs->dead);
+          exit_code = cs->exit_code;
+          release_child (cs);
+          return exit_code;
+        }
+    }
   return -1;
 }
 
@@ -96,8 +193,46 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
   uint32_t *pd;
 
+  /* Close open files and write back mapped files. */
+  syscall_exit ();
+
+  /* Notify parent that we're dead. */
+  if (cur->wait_status != NULL) 
+    {
+      struct wait_status *cs = cur->wait_status;
+
+      printf ("%s: exit(%d)\n", cur->name, cs->exit_code);
+      sema_up (&cs->dead);
+      release_child (cs);
+    }
+
+  /* Free entries of children list. */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      next = list_remove (e);
+      release_child (cs);
+    }
+
+#ifdef VM
+  /* Release the process's frames before its page directory, so
+     that pagedir_destroy() frees only the page tables. */
+  page_exit ();
+#endif
+
+  /* Close the executable, allowing writes to it again. */
+  if (cur->bin_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (cur->bin_file);
+      lock_release (&filesys_lock);
+      cur->bin_file = NULL;
+    }
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -118,20 +253,45 @@ process_exit (void)
 
 /* Sets up the CPU for running user code in the current
    thread.
-   This function is called on every context switch. */
+   This function is called on every context switch.
+
+   Loading CR3 flushes the TLB, so we avoid it when we can.  A
+   kernel thread, such as the idle thread, has no page directory
+   of its own and never touches user memory, so it borrows
+   whatever page directory is already active: every page
+   directory maps the kernel the same way.  Then switching back
+   to the process whose page directory it borrowed needs no
+   reload either.  This is safe because a process switches to
+   the initial page directory itself before destroying its own
+   (see process_exit()), and pagedir.c flushes the TLB whenever
+   it changes the active page directory, borrowed or not. */
 void
 process_activate (void)
 {
   struct thread *t = thread_current ();
 
   /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  if (t->pagedir != NULL && t->pagedir != pagedir_active ())
+    {
+      pagedir_activate (t->pagedir);
+      pd_load_cnt++;
+    }
+  else
+    pd_keep_cnt++;
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
   tss_update ();
 }
 
+/* Prints context switch statistics. */
+void
+process_print_stats (void)
+{
+  printf ("Address spaces: %lld page directory loads, "
+          "%lld TLB flushes avoided\n", pd_load_cnt, pd_keep_cnt);
+}
+
 /* We load ELF binaries.  The following definitions are taken
    from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -195,39 +355,155 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp, char *file_name);
+static bool setup_stack (void **esp, const char *cmd_line, size_t cmd_len);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Executable layout cache.
+
+   Loading an executable requires reading and checking its ELF
+   header and program headers.  Test drivers and the shell run
+   the same few programs over and over, so load() keeps what it
+   learned about the most recently loaded executables, keyed by
+   inode, and maps their segments straight from that.
+
+   Each entry holds its inode open, so that the inode's write
+   count (see inode_write_cnt()) keeps counting, and is stale
+   once that count changes.  The count cannot change while any
+   process is running the executable, because load() denies
+   writes to it.  Protected by filesys_lock. */
+
+/* A loadable segment. */
+struct segment
+  {
+    off_t file_page;            /* Page-aligned offset in file. */
+    uint8_t *upage;             /* Page-aligned user address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero following those. */
+    bool writable;              /* Writable or read-only? */
+  };
+
+/* Validated layout of an executable. */
+struct layout
+  {
+    struct inode *inode;        /* Executable, held open. */
+    unsigned write_cnt;         /* INODE's write count when read. */
+    unsigned last_use;          /* When last loaded, for eviction. */
+    void (*entry) (void);       /* Entry point. */
+    uint8_t *heap_start;        /* End of the highest segment. */
+    size_t segment_cnt;         /* Number of segments. */
+    struct segment *segments;   /* Loadable segments. */
+  };
+
+/* Number of cached layouts. */
+#define LAYOUT_CACHE_SIZE 8
+
+static struct layout *layout_cache[LAYOUT_CACHE_SIZE];
+static unsigned layout_clock;
+
+static struct layout *read_layout (struct file *, const char *file_name);
+static struct layout *lookup_layout (struct inode *);
+static void cache_layout (struct layout *);
+
+/* Loads the ELF executable named PROG_NAME into the current
+   thread, with a stack holding the arguments in CMD_LINE, which
+   is CMD_LEN bytes long.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *prog_name, const char *cmd_line, size_t cmd_len,
+      void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct layout *layout;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
-  int i;
+  size_t i;
+
+  lock_acquire (&filesys_lock);
+  t->heap_start = t->brk = NULL;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  t->pages = page_table_create ();
+  if (t->pages == NULL)
+    goto done;
+  t->rss_soft = rss_soft_limit;
+  t->rss_hard = rss_hard_limit;
+#endif
 
   /* Open executable file. */
-  file = filesys_open (file_name);
+  file = filesys_open (prog_name);
   if (file == NULL) 
     {
-      printf ("load: %s: open failed\n", file_name);
+      printf ("load: %s: open failed\n", prog_name);
       goto done; 
     }
+  file_deny_write (file);
+
+  /* Find the executable's layout, reading it if it isn't
+     cached. */
+  layout = lookup_layout (file_get_inode (file));
+  if (layout == NULL)
+    {
+      layout = read_layout (file, prog_name);
+      if (layout == NULL)
+        goto done;
+      cache_layout (layout);
+    }
+
+  /* Map its segments. */
+  for (i = 0; i < layout->segment_cnt; i++)
+    {
+      const struct segment *s = &layout->segments[i];
+      if (!load_segment (file, s->file_page, s->upage,
+                         s->read_bytes, s->zero_bytes, s->writable))
+        goto done;
+    }
+
+  /* The heap starts out empty, just past the highest segment. */
+  t->heap_start = t->brk = layout->heap_start;
+
+  /* Set up stack. */
+  if (!setup_stack (esp, cmd_line, cmd_len))
+    goto done;
+
+  /* Start address. */
+  *eip = layout->entry;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not.
+     The executable stays open for as long as the process runs,
+     both to deny writes to it and, with virtual memory, because
+     its pages are read in on demand. */
+  if (success)
+    t->bin_file = file;
+  else
+    file_close (file);
+  lock_release (&filesys_lock);
+  return success;
+}
+
+/* Reads and verifies the ELF header and program headers of
+   executable FILE, named FILE_NAME, and returns its layout, or a
+   null pointer if it is not a valid executable or memory is
+   short. */
+static struct layout *
+read_layout (struct file *file, const char *file_name) 
+{
+  struct Elf32_Ehdr ehdr;
+  struct layout *l;
+  off_t file_ofs;
+  int i;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -239,9 +515,17 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024) 
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
+      return NULL; 
     }
 
+  l = malloc (sizeof *l);
+  if (l == NULL)
+    return NULL;
+  l->entry = (void (*) (void)) ehdr.e_entry;
+  l->heap_start = NULL;
+  l->segment_cnt = 0;
+  l->segments = NULL;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
@@ -249,11 +533,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        goto error;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto error;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -267,58 +551,126 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto error;
         case PT_LOAD:
           if (validate_segment (&phdr, file)) 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+              struct segment *segments, *s;
+
+              segments = realloc (l->segments,
+                                  (l->segment_cnt + 1) * sizeof *segments);
+              if (segments == NULL)
+                goto error;
+              l->segments = segments;
+              s = &segments[l->segment_cnt++];
+
+              s->file_page = phdr.p_offset & ~PGMASK;
+              s->upage = (uint8_t *) (phdr.p_vaddr & ~PGMASK);
+              s->writable = (phdr.p_flags & PF_W) != 0;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  s->read_bytes = page_offset + phdr.p_filesz;
+                  s->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                             PGSIZE)
+                                   - s->read_bytes);
                 }
               else 
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  s->read_bytes = 0;
+                  s->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                            PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              if (s->upage + s->read_bytes + s->zero_bytes > l->heap_start)
+                l->heap_start = s->upage + s->read_bytes + s->zero_bytes;
             }
           else
-            goto done;
+            goto error;
           break;
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp, file_name))
-    goto done;
+  l->inode = inode_reopen (file_get_inode (file));
+  l->write_cnt = inode_write_cnt (l->inode);
+  return l;
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+ error:
+  free (l->segments);
+  free (l);
+  return NULL;
+}
 
-  success = true;
+/* Closes layout L's inode and frees L. */
+static void
+free_layout (struct layout *l) 
+{
+  inode_close (l->inode);
+  free (l->segments);
+  free (l);
+}
 
- done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
+/* Returns the cached layout of the executable in INODE, or a
+   null pointer if there is no up-to-date one.  Drops stale
+   entries and those for deleted files along the way. */
+static struct layout *
+lookup_layout (struct inode *inode) 
+{
+  struct layout *found = NULL;
+  size_t i;
+
+  for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+      struct layout *l = layout_cache[i];
+      if (l == NULL)
+        continue;
+      if (l->inode == inode && l->write_cnt == inode_write_cnt (inode))
+        {
+          l->last_use = ++layout_clock;
+          found = l;
+        }
+      else if (l->inode == inode || inode_is_removed (l->inode))
+        {
+          free_layout (l);
+          layout_cache[i] = NULL;
+        }
+    }
+  return found;
 }
-
+
+/* Adds layout L to the cache, evicting the least recently used
+   entry if the cache is full. */
+static void
+cache_layout (struct layout *l) 
+{
+  size_t victim = 0;
+  size_t i;
+
+  for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+      if (layout_cache[i] == NULL)
+        {
+          victim = i;
+          break;
+        }
+      if (layout_cache[i]->last_use < layout_cache[victim]->last_use)
+        victim = i;
+    }
+  if (layout_cache[victim] != NULL)
+    free_layout (layout_cache[victim]);
+
+  l->last_use = ++layout_clock;
+  layout_cache[victim] = l;
+}
+
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -361,6 +713,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   if (phdr->p_vaddr < PGSIZE)
     return false;
 
+  /* The region must stay out of the stack area. */
+  if (phdr->p_vaddr + phdr->p_memsz > (uintptr_t) PHYS_BASE - STACK_MAX)
+    return false;
+
   /* It's okay. */
   return true;
 }
@@ -396,6 +752,20 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from.  It is read in when
+         it is first touched. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0)
+        {
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,6 +785,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -424,54 +795,219 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
+/* Maps a zeroed page at the top of user virtual memory.
+   Returns true if successful, false on failure. */
+static bool
+install_stack_page (void)
+{
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+#ifdef VM
+  return page_allocate (upage, false) != NULL && page_in (upage, true);
+#else
+  uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+#endif
+}
+
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and set it up for the program's main()
+   with the arguments in CMD_LINE, which is CMD_LEN bytes long.
+
+   The command line is copied once, to the top of the stack, and
+   split into arguments in place in a single backward scan, which
+   pushes a pointer to each argument as it finds it: scanning
+   backward leaves argv[0] lowest in memory, where it belongs.
+   process_execute() limits CMD_LEN so that all of this fits in
+   the page. */
 static bool
-setup_stack (void **esp, char *file_name) 
+setup_stack (void **esp, const char *cmd_line, size_t cmd_len) 
 {
-  uint8_t *kpage;
-  bool success = false;
+  char *args, *p;
+  char **argv;
+  uint32_t *sp;
+  int argc = 0;
+
+  ASSERT (cmd_len <= CMDLINE_MAX);
+  if (!install_stack_page ())
+    return false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  /* Copy the command line. */
+  args = (char *) PHYS_BASE - (cmd_len + 1);
+  memcpy (args, cmd_line, cmd_len + 1);
+
+  /* Split it into arguments and push argv[argc] down to
+     argv[0]. */
+  argv = (char **) ROUND_DOWN ((uintptr_t) args, sizeof *argv);
+  *--argv = NULL;
+  for (p = args + cmd_len; p-- > args; )
+    if (*p == ' ')
+      *p = '\0';
+    else if (p == args || p[-1] == ' ')
+      {
+        *--argv = p;
+        argc++;
+      }
+
+  /* Push argv, argc, and a fake return address. */
+  sp = (uint32_t *) argv;
+  *--sp = (uint32_t) argv;
+  *--sp = argc;
+  *--sp = 0;
+  *esp = sp;
+  return true;
+}
+
+/* Returns true if nothing uses the 4 MB of user virtual memory
+   starting at UPAGE, so that the heap may take it with a large
+   page.  Shrinking the heap leaves behind the page table of any
+   4 kB heap pages it unmaps, and other mappings may occupy part
+   of the span. */
+static bool
+span_is_free (void *upage)
+{
+  struct thread *t = thread_current ();
+
+  if (!pagedir_span_is_empty (t->pagedir, upage))
+    return false;
+#ifdef VM
+  return page_range_is_free (upage, PTSPAN / PGSIZE);
+#else
+  return true;
+#endif
+}
+
+/* Maps a zeroed heap page at user virtual address UPAGE.
+   With virtual memory the page is only brought in when it is
+   first touched.
+   Returns true if successful, false on failure. */
+static bool
+map_heap_page (void *upage)
+{
+#ifdef VM
+  return page_allocate (upage, false) != NULL;
+#else
+  uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true))
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+#endif
+}
+
+/* Unmaps the heap page at user virtual address UPAGE and
+   releases its memory. */
+static void
+unmap_heap_page (void *upage)
+{
+#ifdef VM
+  page_deallocate (upage);
+#else
+  uint32_t *pd = thread_current ()->pagedir;
+  void *kpage = pagedir_get_page (pd, upage);
+  pagedir_clear_page (pd, upage);
+  palloc_free_page (kpage);
+#endif
+}
+
+/* Unmaps the heap pages from START up to END.  A large page is
+   unmapped only if it lies entirely above START; otherwise it
+   stays mapped, to be reused if the heap grows again, and
+   process_sbrk() clears the reused part then. */
+static void
+unmap_heap (uint8_t *start, uint8_t *end)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *upage = start;
+
+  while (upage < end)
+    if (pagedir_get_large (pd, upage) != NULL)
+      {
+        uint8_t *large = (uint8_t *) ROUND_DOWN ((uintptr_t) upage, PTSPAN);
+        if (large >= start)
+          palloc_free_large (pagedir_clear_large (pd, large));
+        upage = large + PTSPAN;
+      }
+    else
       {
-        int length = strlen(file_name)+1; //plus 1 for the null byte
-        *esp = PHYS_BASE-length;
-        memcpy(*esp, file_name, length);
-        char *argv_ptr=*esp;
-        while(length % 4 !=0)
+        unmap_heap_page (upage);
+        upage += PGSIZE;
+      }
+}
+
+/* Moves the current process's break, the end of its heap, by
+   INCREMENT bytes, mapping or unmapping heap pages to match.
+   Each 4 MB-aligned stretch of new heap that nothing else uses
+   is mapped with a single large page, if any were set aside
+   with -lp.
+   Returns the previous break if successful, or (void *) -1 if
+   the heap would shrink below its start or grow into the stack
+   area or if memory allocation fails. */
+void *
+process_sbrk (intptr_t increment)
+{
+  struct thread *t = thread_current ();
+  uint8_t *old_brk = t->brk;
+  uint8_t *new_brk = old_brk + increment;
+  uint8_t *heap_max = (uint8_t *) PHYS_BASE - STACK_MAX;
+  uint8_t *old_top = pg_round_up (old_brk);
+  uint8_t *new_top;
+  uint8_t *upage;
+
+  if (increment >= 0
+      ? new_brk < old_brk || new_brk > heap_max
+      : new_brk > old_brk || new_brk < (uint8_t *) t->heap_start)
+    return (void *) -1;
+  new_top = pg_round_up (new_brk);
+
+  upage = old_top;
+  while (upage < new_top)
+    {
+      void *large;
+
+      if ((large = pagedir_get_large (t->pagedir, upage)) != NULL)
         {
-          *esp= *esp-1;
-          length++;
+          /* Still mapped from before the heap last shrank.  The
+             part that becomes heap again may hold stale data, so
+             clear it. */
+          uint8_t *span = (uint8_t *) ROUND_DOWN ((uintptr_t) upage, PTSPAN);
+          uint8_t *end = new_top < span + PTSPAN ? new_top : span + PTSPAN;
+          memset ((uint8_t *) large + (upage - span), 0, end - upage);
+          upage = span + PTSPAN;
         }
-        int *stack_ptr = (int *)*esp;
-        
-        stack_ptr--;
-        *stack_ptr=0;
-        
-        stack_ptr--;
-        *stack_ptr=argv_ptr;
-
-        stack_ptr--;
-        *stack_ptr=stack_ptr+1;
-        
-        stack_ptr--;
-        *stack_ptr = 1;
-        
-        stack_ptr--;
-        *stack_ptr = 0;
-        
-        *esp = stack_ptr;
-      }
+      else if ((uintptr_t) upage % PTSPAN == 0
+               && (size_t) (new_top - upage) >= PTSPAN
+               && span_is_free (upage)
+               && (large = palloc_get_large (PAL_ZERO)) != NULL)
+        {
+          pagedir_set_large (t->pagedir, upage, large, true);
+          upage += PTSPAN;
+        }
+      else if (map_heap_page (upage))
+        upage += PGSIZE;
       else
-        palloc_free_page (kpage);
+        {
+          unmap_heap (old_top, upage);
+          return (void *) -1;
+        }
     }
-  return success;
+  unmap_heap (new_top, old_top);
+
+  t->brk = new_brk;
+  return old_brk;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -491,3 +1027,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,11 +1,41 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stdint.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 
-tid_t process_execute (const char *file_name);
+/* Maximum size of the user stack area.  Only the stack and, at
+   its bottom, the I/O rings (see userprog/ring.c) may occupy
+   it. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+/* Longest command line, in bytes, not counting the null
+   terminator.  Small enough that the command line and its argv
+   array always fit in the first stack page. */
+#define CMDLINE_MAX (PGSIZE / 4)
+
+/* Tracks the completion of a process.  Shared between the
+   process and its parent, and freed by whichever of them lets
+   go of it last. */
+struct wait_status
+  {
+    struct list_elem elem;              /* `children' list element. */
+    struct lock lock;                   /* Protects ref_cnt. */
+    int ref_cnt;                        /* 2=child and parent both alive,
+                                           1=either child or parent alive,
+                                           0=child and parent both dead. */
+    tid_t tid;                          /* Child thread id. */
+    int exit_code;                      /* Child exit code, if dead. */
+    struct semaphore dead;              /* Upped when the child dies. */
+  };
+
+tid_t process_execute (const char *cmd_line);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_print_stats (void);
+void *process_sbrk (intptr_t increment);
 
 #endif /* userprog/process.h */
@@ -0,0 +1,373 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+
+/* Submission and completion rings (see lib/ring.h).
+
+   The rings and buffer area are kernel pages mapped into the
+   process at RING_BASE, so the kernel reaches them through its
+   own mapping from any thread, and they never fault or get
+   evicted.  ring_enter() copies submissions out of the shared
+   ring, so that the process cannot change them afterward, and
+   queues the ring for the worker threads.  A worker drains a
+   ring's operations in order, taking the file system lock once
+   per batch of operations rather than once per operation. */
+
+/* Number of worker threads. */
+#define RING_WORKERS 2
+
+/* Most operations carried out under one acquisition of the file
+   system lock. */
+#define BATCH_MAX 16
+
+/* Where the rings are mapped: the bottom of the stack area,
+   which nothing else may occupy. */
+#define RING_BASE ((uint8_t *) PHYS_BASE - STACK_MAX)
+
+/* A process's rings. */
+struct ring
+  {
+    /* Protected by LOCK. */
+    struct lock lock;                   /* Protects members below. */
+    struct condition done;              /* Signaled on completions. */
+    struct ring_sqe pending[RING_ENTRIES]; /* Submitted, not started. */
+    uint32_t pend_head, pend_tail;      /* Bounds of PENDING. */
+    uint32_t sq_head;                   /* Kernel's copy of sq->head. */
+    uint32_t cq_tail;                   /* Kernel's copy of cq->tail. */
+    size_t inflight;                    /* Submitted, not completed. */
+    bool queued;                        /* On work_list or draining? */
+    struct list_elem elem;              /* work_list element. */
+
+    /* Owned by the worker draining the ring. */
+    struct file *files[RING_FILES];     /* File slots. */
+
+    /* Set up by ring_setup(), then unchanged. */
+    uint8_t *kpages;                    /* Kernel address of pages. */
+    size_t page_cnt;                    /* Number of pages. */
+    struct ring_sq *sq;                 /* Submission ring. */
+    struct ring_cq *cq;                 /* Completion ring. */
+    uint8_t *bufs;                      /* Buffer area. */
+    size_t buf_size;                    /* Buffer area size. */
+  };
+
+/* Rings with operations for the workers. */
+static struct lock work_lock;
+static struct condition work_ready;
+static struct list work_list;
+static bool workers_started;
+
+static thread_func worker NO_RETURN;
+
+/* Initializes the ring work queue. */
+void
+ring_init (void)
+{
+  lock_init (&work_lock);
+  cond_init (&work_ready);
+  list_init (&work_list);
+}
+
+/* Starts the worker threads, if they are not running yet.
+   Returns true if successful, false on failure. */
+static bool
+start_workers (void)
+{
+  bool ok = true;
+
+  lock_acquire (&work_lock);
+  if (!workers_started)
+    {
+      int i;
+
+      for (i = 0; i < RING_WORKERS; i++)
+        if (thread_create ("ring-worker", PRI_DEFAULT, worker, NULL)
+            == TID_ERROR)
+          {
+            ok = i > 0;
+            break;
+          }
+      workers_started = ok;
+    }
+  lock_release (&work_lock);
+  return ok;
+}
+
+/* Maps rings with a buffer area of BUF_PAGES pages into the
+   current process and stores their addresses in *PARAMS.
+   Returns true if successful, false if the process already has
+   rings or on failure. */
+bool
+ring_setup (size_t buf_pages, struct ring_params *params)
+{
+  struct thread *t = thread_current ();
+  struct ring *r;
+  size_t i;
+
+  ASSERT (sizeof *r->sq <= PGSIZE && sizeof *r->cq <= PGSIZE);
+
+  if (t->ring != NULL || buf_pages > RING_BUF_PAGES_MAX
+      || !start_workers ())
+    return false;
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return false;
+  r->page_cnt = 2 + buf_pages;
+  r->kpages = palloc_get_multiple (PAL_ZERO, r->page_cnt);
+  if (r->kpages == NULL)
+    {
+      free (r);
+      return false;
+    }
+  for (i = 0; i < r->page_cnt; i++)
+    if (!pagedir_set_page (t->pagedir, RING_BASE + i * PGSIZE,
+                           r->kpages + i * PGSIZE, true))
+      {
+        while (i-- > 0)
+          pagedir_clear_page (t->pagedir, RING_BASE + i * PGSIZE);
+        palloc_free_multiple (r->kpages, r->page_cnt);
+        free (r);
+        return false;
+      }
+
+  lock_init (&r->lock);
+  cond_init (&r->done);
+  r->pend_head = r->pend_tail = 0;
+  r->sq_head = 0;
+  r->cq_tail = 0;
+  r->inflight = 0;
+  r->queued = false;
+  for (i = 0; i < RING_FILES; i++)
+    r->files[i] = NULL;
+  r->sq = (struct ring_sq *) r->kpages;
+  r->cq = (struct ring_cq *) (r->kpages + PGSIZE);
+  r->bufs = r->kpages + 2 * PGSIZE;
+  r->buf_size = buf_pages * PGSIZE;
+  t->ring = r;
+
+  params->sq = (struct ring_sq *) RING_BASE;
+  params->cq = (struct ring_cq *) (RING_BASE + PGSIZE);
+  params->bufs = RING_BASE + 2 * PGSIZE;
+  params->buf_size = r->buf_size;
+  return true;
+}
+
+/* Returns the number of completions R's process has yet to
+   consume.  The process controls cq->head, so the result is
+   capped at RING_ENTRIES. */
+static size_t
+unreaped (const struct ring *r)
+{
+  uint32_t n = r->cq_tail - r->cq->head;
+  return n <= RING_ENTRIES ? n : RING_ENTRIES;
+}
+
+/* Submits up to TO_SUBMIT operations from the current process's
+   submission ring, then waits until at least MIN_COMPLETE
+   completions are waiting to be consumed or nothing remains
+   outstanding.
+   Returns the number of operations submitted, or -1 if the
+   process has no rings or its submission ring is corrupt. */
+int
+ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct ring *r = thread_current ()->ring;
+  unsigned submitted = 0;
+  uint32_t sq_tail;
+
+  if (r == NULL)
+    return -1;
+
+  lock_acquire (&r->lock);
+  sq_tail = r->sq->tail;
+  barrier ();
+  if (sq_tail - r->sq_head > RING_ENTRIES)
+    {
+      lock_release (&r->lock);
+      return -1;
+    }
+
+  /* Copy submissions, as long as there is room for their
+     completions. */
+  while (submitted < to_submit && r->sq_head != sq_tail
+         && r->inflight + unreaped (r) < RING_ENTRIES)
+    {
+      r->pending[r->pend_tail++ % RING_ENTRIES]
+        = r->sq->sqes[r->sq_head++ % RING_ENTRIES];
+      r->inflight++;
+      submitted++;
+    }
+  r->sq->head = r->sq_head;
+
+  /* Hand the ring to a worker. */
+  if (submitted > 0 && !r->queued)
+    {
+      r->queued = true;
+      lock_acquire (&work_lock);
+      list_push_back (&work_list, &r->elem);
+      cond_signal (&work_ready, &work_lock);
+      lock_release (&work_lock);
+    }
+
+  while (unreaped (r) < min_complete && r->inflight > 0)
+    cond_wait (&r->done, &r->lock);
+  lock_release (&r->lock);
+
+  return submitted;
+}
+
+/* Carries out operation SQE on ring R.  The caller must hold the
+   file system lock.  Returns the result for its completion. */
+static int32_t
+execute (struct ring *r, const struct ring_sqe *sqe)
+{
+  struct file **slot;
+  uint8_t *buf;
+
+  if (sqe->opcode == RING_NOP)
+    return 0;
+  if (sqe->file < 0 || sqe->file >= RING_FILES
+      || sqe->buf > r->buf_size || sqe->len > r->buf_size - sqe->buf)
+    return -1;
+  slot = &r->files[sqe->file];
+  buf = r->bufs + sqe->buf;
+
+  switch (sqe->opcode)
+    {
+    case RING_OPEN:
+      {
+        /* Copy the name, which the process could change while
+           we look it up. */
+        char name[NAME_MAX + 1];
+        size_t n = sqe->len < sizeof name ? sqe->len : sizeof name;
+
+        memcpy (name, buf, n);
+        if (*slot != NULL || memchr (name, '\0', n) == NULL)
+          return -1;
+        *slot = filesys_open (name);
+        return *slot != NULL ? 0 : -1;
+      }
+
+    case RING_CLOSE:
+      if (*slot == NULL)
+        return -1;
+      file_close (*slot);
+      *slot = NULL;
+      return 0;
+
+    case RING_READ:
+      if (*slot == NULL)
+        return -1;
+      return (sqe->pos < 0
+              ? file_read (*slot, buf, sqe->len)
+              : file_read_at (*slot, buf, sqe->len, sqe->pos));
+
+    case RING_WRITE:
+      if (*slot == NULL)
+        return -1;
+      return (sqe->pos < 0
+              ? file_write (*slot, buf, sqe->len)
+              : file_write_at (*slot, buf, sqe->len, sqe->pos));
+
+    default:
+      return -1;
+    }
+}
+
+/* Carries out R's pending operations in order and posts their
+   completions, a batch at a time. */
+static void
+drain (struct ring *r)
+{
+  struct ring_sqe batch[BATCH_MAX];
+  int32_t results[BATCH_MAX];
+  size_t cnt, i;
+
+  lock_acquire (&r->lock);
+  while (r->pend_head != r->pend_tail)
+    {
+      for (cnt = 0; cnt < BATCH_MAX && r->pend_head != r->pend_tail; cnt++)
+        batch[cnt] = r->pending[r->pend_head++ % RING_ENTRIES];
+      lock_release (&r->lock);
+
+      lock_acquire (&filesys_lock);
+      for (i = 0; i < cnt; i++)
+        results[i] = execute (r, &batch[i]);
+      lock_release (&filesys_lock);
+
+      lock_acquire (&r->lock);
+      for (i = 0; i < cnt; i++)
+        {
+          struct ring_cqe *cqe = &r->cq->cqes[r->cq_tail++ % RING_ENTRIES];
+          cqe->user_data = batch[i].user_data;
+          cqe->result = results[i];
+        }
+      barrier ();
+      r->cq->tail = r->cq_tail;
+      r->inflight -= cnt;
+      cond_broadcast (&r->done, &r->lock);
+    }
+  r->queued = false;
+  cond_broadcast (&r->done, &r->lock);
+  lock_release (&r->lock);
+}
+
+/* Worker thread. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct ring *r;
+
+      lock_acquire (&work_lock);
+      while (list_empty (&work_list))
+        cond_wait (&work_ready, &work_lock);
+      r = list_entry (list_pop_front (&work_list), struct ring, elem);
+      lock_release (&work_lock);
+
+      drain (r);
+    }
+}
+
+/* Tears down the current process's rings, if any, once the
+   workers are done with them. */
+void
+ring_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct ring *r = t->ring;
+  size_t i;
+
+  if (r == NULL)
+    return;
+
+  lock_acquire (&r->lock);
+  while (r->queued)
+    cond_wait (&r->done, &r->lock);
+  lock_release (&r->lock);
+
+  lock_acquire (&filesys_lock);
+  for (i = 0; i < RING_FILES; i++)
+    if (r->files[i] != NULL)
+      file_close (r->files[i]);
+  lock_release (&filesys_lock);
+
+  for (i = 0; i < r->page_cnt; i++)
+    pagedir_clear_page (t->pagedir, RING_BASE + i * PGSIZE);
+  palloc_free_multiple (r->kpages, r->page_cnt);
+  free (r);
+  t->ring = NULL;
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <ring.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void ring_init (void);
+bool ring_setup (size_t buf_pages, struct ring_params *);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+void ring_exit (void);
+
+#endif /* userprog/ring.h */
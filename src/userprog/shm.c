@@ -0,0 +1,355 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Shared memory segments (see lib/shm.h).
+
+   A segment's frames are kernel pages, like the I/O ring pages,
+   so they are never evicted and stay put while any number of
+   page directories map them.  Every attachment maps all of a
+   segment's frames, so a single count of attachments per
+   segment serves as the reference count of each of its frames:
+   the frames are freed when the last page directory that maps
+   them lets go.  A segment that is never attached is freed when
+   the process that created it exits.
+
+   Because the frames come from the kernel pool, which the rest
+   of the kernel needs too, shm_create reserves a segment's pages
+   against a system-wide budget of SHM_TOTAL_PAGES_MAX before it
+   allocates any of them, and free_shm returns them.
+
+   With VM, each attached page also has a struct page marked
+   shared in the process's page table, which keeps the rest of
+   the VM system from placing anything else at that address and
+   from trying to page it in or out. */
+
+/* A shared memory segment. */
+struct shm
+  {
+    struct list_elem elem;              /* shm_list element. */
+    char name[SHM_NAME_MAX + 1];        /* Name. */
+    size_t page_cnt;                    /* Number of pages. */
+    int attach_cnt;                     /* Number of attachments. */
+    struct thread *creator;             /* Creating process, until exit. */
+    void *kpages[];                     /* PAGE_CNT frames. */
+  };
+
+/* A segment's attachment to a process. */
+struct shm_attachment
+  {
+    struct list_elem elem;              /* `shm_attachments' element. */
+    struct shm *shm;                    /* Attached segment. */
+    uint8_t *base;                      /* User address of first page. */
+  };
+
+/* All segments, protected by shm_lock. */
+static struct lock shm_lock;
+static struct list shm_list;
+
+/* Number of pages reserved by segments, protected by shm_lock. */
+static size_t shm_page_cnt;
+
+/* Initializes the segment list. */
+void
+shm_init (void)
+{
+  lock_init (&shm_lock);
+  list_init (&shm_list);
+}
+
+/* Returns the segment named NAME, or a null pointer if there is
+   none.  The caller must hold shm_lock. */
+static struct shm *
+lookup_shm (const char *name)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&shm_lock));
+
+  for (e = list_begin (&shm_list); e != list_end (&shm_list);
+       e = list_next (e))
+    {
+      struct shm *s = list_entry (e, struct shm, elem);
+      if (!strcmp (s->name, name))
+        return s;
+    }
+  return NULL;
+}
+
+/* Reserves PAGE_CNT pages of the segment budget.
+   Returns true if successful, false if the budget would be
+   exceeded. */
+static bool
+reserve_pages (size_t page_cnt)
+{
+  bool ok;
+
+  lock_acquire (&shm_lock);
+  ok = page_cnt <= SHM_TOTAL_PAGES_MAX - shm_page_cnt;
+  if (ok)
+    shm_page_cnt += page_cnt;
+  lock_release (&shm_lock);
+  return ok;
+}
+
+/* Returns PAGE_CNT pages to the segment budget. */
+static void
+release_pages (size_t page_cnt)
+{
+  lock_acquire (&shm_lock);
+  ASSERT (shm_page_cnt >= page_cnt);
+  shm_page_cnt -= page_cnt;
+  lock_release (&shm_lock);
+}
+
+/* Frees segment S's frames, returns its pages to the budget,
+   and frees S itself.  Frames that were never allocated are
+   null. */
+static void
+free_shm (struct shm *s)
+{
+  size_t i;
+
+  for (i = 0; i < s->page_cnt; i++)
+    palloc_free_page (s->kpages[i]);
+  release_pages (s->page_cnt);
+  free (s);
+}
+
+/* Creates a segment named NAME of PAGE_CNT zeroed pages.
+   Returns true if successful, false if NAME is empty, too long,
+   or already in use, if PAGE_CNT is 0 or more than
+   SHM_PAGES_MAX, if the segments would then hold more than
+   SHM_TOTAL_PAGES_MAX pages in all, or if memory allocation
+   fails. */
+bool
+shm_create (const char *name, size_t page_cnt)
+{
+  struct shm *s;
+  size_t i;
+  bool ok;
+
+  if (*name == '\0' || strnlen (name, SHM_NAME_MAX + 1) > SHM_NAME_MAX
+      || page_cnt == 0 || page_cnt > SHM_PAGES_MAX)
+    return false;
+  if (!reserve_pages (page_cnt))
+    return false;
+
+  s = calloc (1, sizeof *s + page_cnt * sizeof *s->kpages);
+  if (s == NULL)
+    {
+      release_pages (page_cnt);
+      return false;
+    }
+  strlcpy (s->name, name, sizeof s->name);
+  s->page_cnt = page_cnt;
+  s->attach_cnt = 0;
+  s->creator = thread_current ();
+  for (i = 0; i < page_cnt; i++)
+    {
+      s->kpages[i] = palloc_get_page (PAL_ZERO);
+      if (s->kpages[i] == NULL)
+        {
+          free_shm (s);
+          return false;
+        }
+    }
+
+  lock_acquire (&shm_lock);
+  ok = lookup_shm (name) == NULL;
+  if (ok)
+    list_push_back (&shm_list, &s->elem);
+  lock_release (&shm_lock);
+
+  if (!ok)
+    free_shm (s);
+  return ok;
+}
+
+/* Removes the mappings of the first PAGE_CNT pages starting at
+   BASE from the current process. */
+static void
+unmap_pages (uint8_t *base, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+#ifdef VM
+      page_deallocate (base + i * PGSIZE);
+#else
+      pagedir_clear_page (thread_current ()->pagedir, base + i * PGSIZE);
+#endif
+    }
+}
+
+/* Maps segment S's frames into the current process starting at
+   BASE.  Returns true if successful, false if any of the pages
+   is outside the part of user memory available for mappings or
+   is already in use, or if memory allocation fails. */
+static bool
+map_pages (struct shm *s, uint8_t *base)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  if (base == NULL || pg_ofs (base) != 0
+      || base >= (uint8_t *) PHYS_BASE - STACK_MAX
+      || s->page_cnt > (size_t) ((uint8_t *) PHYS_BASE - STACK_MAX - base)
+                       / PGSIZE)
+    return false;
+
+  for (i = 0; i < s->page_cnt; i++)
+    {
+      uint8_t *upage = base + i * PGSIZE;
+#ifdef VM
+      struct page *p;
+
+      if (pagedir_get_large (pd, upage) != NULL
+          || (p = page_allocate (upage, false)) == NULL)
+        break;
+      p->shared = true;
+      if (!pagedir_set_page (pd, upage, s->kpages[i], true))
+        {
+          page_deallocate (upage);
+          break;
+        }
+#else
+      if (pagedir_get_page (pd, upage) != NULL
+          || !pagedir_set_page (pd, upage, s->kpages[i], true))
+        break;
+#endif
+    }
+  if (i < s->page_cnt)
+    {
+      unmap_pages (base, i);
+      return false;
+    }
+  return true;
+}
+
+/* Attaches the segment named NAME to the current process at
+   ADDR, which must be page-aligned.
+   Returns ADDR if successful, or a null pointer if there is no
+   such segment, the pages at ADDR are not all free, or memory
+   allocation fails. */
+void *
+shm_attach (const char *name, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct shm_attachment *a;
+  struct shm *s;
+
+  a = malloc (sizeof *a);
+  if (a == NULL)
+    return NULL;
+
+  lock_acquire (&shm_lock);
+  s = lookup_shm (name);
+  if (s == NULL || !map_pages (s, addr))
+    {
+      lock_release (&shm_lock);
+      free (a);
+      return NULL;
+    }
+  s->attach_cnt++;
+  lock_release (&shm_lock);
+
+  a->shm = s;
+  a->base = addr;
+  list_push_back (&t->shm_attachments, &a->elem);
+  return addr;
+}
+
+/* Unmaps attachment A from the current process and frees A.
+   If it was its segment's last attachment, releases the
+   segment. */
+static void
+detach (struct shm_attachment *a)
+{
+  struct shm *s = a->shm;
+  bool release;
+
+  list_remove (&a->elem);
+  unmap_pages (a->base, s->page_cnt);
+  free (a);
+
+  lock_acquire (&shm_lock);
+  release = --s->attach_cnt == 0;
+  if (release)
+    list_remove (&s->elem);
+  lock_release (&shm_lock);
+
+  if (release)
+    free_shm (s);
+}
+
+/* Detaches the segment attached to the current process at
+   ADDR.  Returns true if successful, false if no segment is
+   attached there. */
+bool
+shm_detach (void *addr)
+{
+  struct list *attachments = &thread_current ()->shm_attachments;
+  struct list_elem *e;
+
+  for (e = list_begin (attachments); e != list_end (attachments);
+       e = list_next (e))
+    {
+      struct shm_attachment *a = list_entry (e, struct shm_attachment, elem);
+      if (a->base == addr)
+        {
+          detach (a);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Detaches all of the current process's segments, and frees
+   those it created that nothing has attached.  Must be called
+   before its page directory is destroyed, which would otherwise
+   free the segments' frames along with it. */
+void
+shm_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e, *next;
+  struct list unused;
+
+  while (!list_empty (&t->shm_attachments))
+    detach (list_entry (list_front (&t->shm_attachments),
+                        struct shm_attachment, elem));
+
+  list_init (&unused);
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&shm_list); e != list_end (&shm_list); e = next)
+    {
+      struct shm *s = list_entry (e, struct shm, elem);
+      next = list_next (e);
+      if (s->creator == t)
+        {
+          s->creator = NULL;
+          if (s->attach_cnt == 0)
+            {
+              list_remove (&s->elem);
+              list_push_back (&unused, &s->elem);
+            }
+        }
+    }
+  lock_release (&shm_lock);
+
+  while (!list_empty (&unused))
+    free_shm (list_entry (list_pop_front (&unused), struct shm, elem));
+}
@@ -0,0 +1,14 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <shm.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void shm_init (void);
+bool shm_create (const char *name, size_t page_cnt);
+void *shm_attach (const char *name, void *addr);
+bool shm_detach (void *addr);
+void shm_exit (void);
+
+#endif /* userprog/shm.h */
@@ -1,51 +1,1130 @@
 #include "userprog/syscall.h"
+#include <bitmap.h>
+#include <iovec.h>
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/ring.h"
+#include "userprog/shm.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include <memusage.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
+
+/* Serializes access to the file system. */
+struct lock filesys_lock;
+
+/* System call handler.  Arguments are passed as 32-bit words,
+   so each handler takes up to three ints, whatever their
+   declared types. */
+typedef int syscall_function (int, int, int);
+
+/* A system call. */
+struct syscall
+  {
+    size_t arg_cnt;             /* Number of arguments. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+static int sys_halt (void);
+static int sys_exit (int status);
+static int sys_exec (const char *ufile);
+static int sys_wait (tid_t);
+static int sys_create (const char *ufile, unsigned initial_size);
+static int sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int handle);
+static int sys_read (int handle, void *udst, unsigned size);
+static int sys_write (int handle, const void *usrc, unsigned size);
+static int sys_seek (int handle, unsigned position);
+static int sys_tell (int handle);
+static int sys_close (int handle);
+static int sys_pipe (int *uhandles);
+static int sys_dup (int handle);
+static int sys_dup2 (int handle, int new_handle);
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static int sys_chdir (const char *udir);
+static int sys_mkdir (const char *udir);
+static int sys_readdir (int handle, char *uname);
+static int sys_isdir (int handle);
+static int sys_inumber (int handle);
+static int sys_sbrk (intptr_t increment);
+static int sys_memusage (void *uusage);
+static int sys_readv (int handle, const struct iovec *uiov, int iovcnt);
+static int sys_writev (int handle, const struct iovec *uiov, int iovcnt);
+static int sys_ring_setup (size_t buf_pages, struct ring_params *uparams);
+static int sys_ring_enter (unsigned to_submit, unsigned min_complete);
+static int sys_shm_create (const char *uname, size_t page_cnt);
+static int sys_shm_attach (const char *uname, void *addr);
+static int sys_shm_detach (void *addr);
+
+/* Initializer for a system call that takes ARG_CNT arguments.
+   Casting through void (*) (void) marks the change of function
+   type as deliberate. */
+#define SYSCALL(ARG_CNT, FUNC) \
+        {ARG_CNT, (syscall_function *) (void (*) (void)) FUNC}
+
+/* Table of system calls, indexed by system call number. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = SYSCALL (0, sys_halt),
+    [SYS_EXIT] = SYSCALL (1, sys_exit),
+    [SYS_EXEC] = SYSCALL (1, sys_exec),
+    [SYS_WAIT] = SYSCALL (1, sys_wait),
+    [SYS_CREATE] = SYSCALL (2, sys_create),
+    [SYS_REMOVE] = SYSCALL (1, sys_remove),
+    [SYS_OPEN] = SYSCALL (1, sys_open),
+    [SYS_FILESIZE] = SYSCALL (1, sys_filesize),
+    [SYS_READ] = SYSCALL (3, sys_read),
+    [SYS_WRITE] = SYSCALL (3, sys_write),
+    [SYS_SEEK] = SYSCALL (2, sys_seek),
+    [SYS_TELL] = SYSCALL (1, sys_tell),
+    [SYS_CLOSE] = SYSCALL (1, sys_close),
+    [SYS_MMAP] = SYSCALL (2, sys_mmap),
+    [SYS_MUNMAP] = SYSCALL (1, sys_munmap),
+    [SYS_CHDIR] = SYSCALL (1, sys_chdir),
+    [SYS_MKDIR] = SYSCALL (1, sys_mkdir),
+    [SYS_READDIR] = SYSCALL (2, sys_readdir),
+    [SYS_ISDIR] = SYSCALL (1, sys_isdir),
+    [SYS_INUMBER] = SYSCALL (1, sys_inumber),
+    [SYS_SBRK] = SYSCALL (1, sys_sbrk),
+    [SYS_MEMUSAGE] = SYSCALL (1, sys_memusage),
+    [SYS_READV] = SYSCALL (3, sys_readv),
+    [SYS_WRITEV] = SYSCALL (3, sys_writev),
+    [SYS_RING_SETUP] = SYSCALL (2, sys_ring_setup),
+    [SYS_RING_ENTER] = SYSCALL (2, sys_ring_enter),
+    [SYS_DUP] = SYSCALL (1, sys_dup),
+    [SYS_DUP2] = SYSCALL (2, sys_dup2),
+    [SYS_PIPE] = SYSCALL (1, sys_pipe),
+    [SYS_SHM_CREATE] = SYSCALL (2, sys_shm_create),
+    [SYS_SHM_ATTACH] = SYSCALL (2, sys_shm_attach),
+    [SYS_SHM_DETACH] = SYSCALL (1, sys_shm_detach),
+  };
+
+/* Largest number of arguments taken by any system call. */
+#define SYSCALL_MAX_ARGS 3
 
 static void syscall_handler (struct intr_frame *);
-static void write_handler (struct intr_frame *);
+static void copy_in (void *, const void *, size_t);
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
+  lock_init (&filesys_lock);
+  ring_init ();
+  shm_init ();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* Executes the system call whose number and arguments are on
+   the user stack at USP, and returns its result.  Every call
+   costs one table lookup and one validated copy of its
+   arguments from the user stack. */
+static int
+dispatch (const uint32_t *usp)
+{
+  const struct syscall *sc;
+  unsigned call_nr;
+  int args[SYSCALL_MAX_ARGS];
+
+  /* Get the system call. */
+  copy_in (&call_nr, usp, sizeof call_nr);
+  if (call_nr >= sizeof syscall_table / sizeof *syscall_table)
+    thread_exit ();
+  sc = syscall_table + call_nr;
+
+  /* Get the system call arguments. */
+  ASSERT (sc->arg_cnt <= SYSCALL_MAX_ARGS);
+  memset (args, 0, sizeof args);
+  copy_in (args, usp + 1, sizeof *args * sc->arg_cnt);
+
+  /* Execute the system call. */
+  return sc->func (args[0], args[1], args[2]);
+}
+
+/* System call handler for "int $0x30". */
 static void
-syscall_handler (struct intr_frame *f) 
+syscall_handler (struct intr_frame *f)
+{
+  f->eax = dispatch (f->esp);
+}
+
+/* System call handler for SYSENTER, called by sysenter_entry
+   with the process's stack pointer USP. */
+int
+syscall_fast (const void *usp)
+{
+  return dispatch (usp);
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.
+   Call thread_exit() if any of the user accesses are invalid. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (!copy_from_user (dst, usrc, size))
+    thread_exit ();
+}
+
+/* Creates a copy of user string US in kernel memory
+   and returns it as a page that must be freed with
+   palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.
+   Call thread_exit() if any of the user accesses are invalid. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      int c = get_user ((const uint8_t *) us + length);
+      if (c < 0)
+        {
+          palloc_free_page (ks);
+          thread_exit ();
+        }
+      ks[length] = c;
+      if (c == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Halt system call. */
+static int
+sys_halt (void)
 {
-  uint32_t intr_num = *(int *)(f->esp);
-  if(intr_num ==SYS_WRITE)
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static int
+sys_exit (int exit_code)
+{
+  thread_current ()->wait_status->exit_code = exit_code;
+  thread_exit ();
+  NOT_REACHED ();
+}
+
+/* Exec system call. */
+static int
+sys_exec (const char *ufile)
+{
+  tid_t tid;
+  char *kfile = copy_in_string (ufile);
+
+  tid = process_execute (kfile);
+  palloc_free_page (kfile);
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (tid_t child)
+{
+  return process_wait (child);
+}
+
+/* Create system call. */
+static int
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, initial_size);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* What a file descriptor refers to. */
+enum fd_type
   {
-  	write_handler(f);
-  }
-  else if(intr_num==SYS_EXIT)
+    FD_STDIN,                   /* Console input. */
+    FD_STDOUT,                  /* Console output. */
+    FD_FILE,                    /* An open file. */
+    FD_PIPE_READ,               /* Read end of a pipe. */
+    FD_PIPE_WRITE               /* Write end of a pipe. */
+  };
+
+/* A file descriptor.  Descriptors made by dup() and dup2() share
+   one struct file or pipe, which counts its references. */
+struct fd
   {
-  	int *stack_ptr= (int *)(f->esp);
-  	int exit_num= *(stack_ptr+1);
-  	struct thread *cur = thread_current();
-  	//printf ("%s: exit(%d)\n", cur->tid_name, exit_num);
-  	thread_exit();
-  }
-  else
+    enum fd_type type;          /* What the descriptor refers to. */
+    struct file *file;          /* File, if TYPE is FD_FILE. */
+    struct pipe *pipe;          /* Pipe, if TYPE is FD_PIPE_*. */
+  };
+
+/* Initial and largest number of file descriptors per process. */
+#define FD_INIT 16
+#define FD_MAX 8192
+
+/* Creates T's file descriptor table, if it does not exist yet,
+   with console input and output on the standard handles.
+   Returns true if successful, false if memory is short. */
+static bool
+init_fds (struct thread *t)
+{
+  if (t->fds != NULL)
+    return true;
+
+  t->fds = malloc (FD_INIT * sizeof *t->fds);
+  t->fd_map = bitmap_create (FD_INIT);
+  if (t->fds == NULL || t->fd_map == NULL)
+    {
+      free (t->fds);
+      bitmap_destroy (t->fd_map);
+      t->fds = NULL;
+      t->fd_map = NULL;
+      return false;
+    }
+  t->fds[STDIN_FILENO].type = FD_STDIN;
+  t->fds[STDOUT_FILENO].type = FD_STDOUT;
+  bitmap_mark (t->fd_map, STDIN_FILENO);
+  bitmap_mark (t->fd_map, STDOUT_FILENO);
+  return true;
+}
+
+/* Grows T's file descriptor table, by doubling, until it has
+   room for HANDLE, which must be less than FD_MAX.
+   Returns true if successful, false if memory is short. */
+static bool
+grow_fds (struct thread *t, size_t handle)
+{
+  size_t old_cnt = bitmap_size (t->fd_map);
+  size_t new_cnt, i;
+  struct bitmap *map;
+  struct fd *fds;
+
+  ASSERT (handle < FD_MAX);
+  for (new_cnt = old_cnt; new_cnt <= handle; new_cnt *= 2)
+    continue;
+  if (new_cnt > FD_MAX)
+    new_cnt = FD_MAX;
+
+  fds = realloc (t->fds, new_cnt * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  t->fds = fds;
+
+  map = bitmap_create (new_cnt);
+  if (map == NULL)
+    return false;
+  for (i = 0; i < old_cnt; i++)
+    bitmap_set (map, i, bitmap_test (t->fd_map, i));
+  bitmap_destroy (t->fd_map);
+  t->fd_map = map;
+  return true;
+}
+
+/* Binds FD to the lowest free handle in the current process and
+   returns the handle, or -1 if the table is full or memory is
+   short.  On success, the table takes over FD's reference to its
+   file. */
+static int
+install_fd (const struct fd *fd)
+{
+  struct thread *cur = thread_current ();
+  size_t handle;
+
+  if (!init_fds (cur))
+    return -1;
+  handle = bitmap_scan_and_flip (cur->fd_map, 0, 1, false);
+  if (handle == BITMAP_ERROR)
+    {
+      handle = bitmap_size (cur->fd_map);
+      if (handle >= FD_MAX || !grow_fds (cur, handle))
+        return -1;
+      bitmap_mark (cur->fd_map, handle);
+    }
+  cur->fds[handle] = *fd;
+  return handle;
+}
+
+/* Adds a reference to FD's file or pipe, if any, for a copy of
+   FD. */
+static void
+retain_fd (struct fd *fd)
+{
+  if (fd->type == FD_FILE)
+    {
+      lock_acquire (&filesys_lock);
+      file_dup (fd->file);
+      lock_release (&filesys_lock);
+    }
+  else if (fd->type == FD_PIPE_READ || fd->type == FD_PIPE_WRITE)
+    pipe_open (fd->pipe, fd->type == FD_PIPE_WRITE);
+}
+
+/* Drops FD's reference to its file or pipe, if any. */
+static void
+release_fd (struct fd *fd)
+{
+  if (fd->type == FD_FILE)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (fd->file);
+      lock_release (&filesys_lock);
+    }
+  else if (fd->type == FD_PIPE_READ || fd->type == FD_PIPE_WRITE)
+    pipe_close (fd->pipe, fd->type == FD_PIPE_WRITE);
+}
+
+/* Gives the current process, newly started by PARENT, its own
+   file descriptor table, with copies of PARENT's standard input
+   and output descriptors if PARENT has them open, so that a
+   parent can redirect a child's input and output with dup2()
+   before exec().  Returns true if successful, false if memory
+   is short. */
+bool
+syscall_inherit_fds (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  int handle;
+
+  if (!init_fds (cur))
+    return false;
+  if (parent->fds == NULL)
+    return true;
+  for (handle = STDIN_FILENO; handle <= STDOUT_FILENO; handle++)
+    if (bitmap_test (parent->fd_map, handle))
+      {
+        cur->fds[handle] = parent->fds[handle];
+        retain_fd (&cur->fds[handle]);
+      }
+  return true;
+}
+
+/* Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  struct fd fd;
+  int handle = -1;
+
+  fd.type = FD_FILE;
+  lock_acquire (&filesys_lock);
+  fd.file = filesys_open (kfile);
+  lock_release (&filesys_lock);
+  if (fd.file != NULL)
+    {
+      handle = install_fd (&fd);
+      if (handle < 0)
+        release_fd (&fd);
+    }
+
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Returns the file descriptor associated with the given handle.
+   Terminates the process if HANDLE is not open. */
+static struct fd *
+lookup_fd (int handle)
+{
+  struct thread *cur = thread_current ();
+
+  if (!init_fds (cur)
+      || handle < 0 || (size_t) handle >= bitmap_size (cur->fd_map)
+      || !bitmap_test (cur->fd_map, handle))
+    thread_exit ();
+  return &cur->fds[handle];
+}
+
+/* Returns the file associated with the given handle.
+   Terminates the process if HANDLE is not associated with an
+   open file. */
+static struct file *
+lookup_file (int handle)
+{
+  struct fd *fd = lookup_fd (handle);
+
+  if (fd->type != FD_FILE)
+    thread_exit ();
+  return fd->file;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (int handle)
+{
+  struct file *file = lookup_file (handle);
+  int size;
+
+  lock_acquire (&filesys_lock);
+  size = file_length (file);
+  lock_release (&filesys_lock);
+
+  return size;
+}
+
+/* Reads from HANDLE into the IOVCNT user buffers in IOV, which
+   is in kernel memory, filling each in turn.  Data is read into
+   a kernel buffer up to a page at a time, with one call to the
+   file system, and then scattered to the user buffers, so that
+   the file system never touches user memory.
+   Returns the number of bytes read, or -1 on error. */
+static int
+read_iov (int handle, const struct iovec *iov, int iovcnt)
+{
+  struct fd fd = *lookup_fd (handle);
+  size_t seg = 0, seg_ofs = 0;
+  uint8_t *kbuf;
+  int bytes_read = 0;
+
+  if (fd.type != FD_STDIN && fd.type != FD_FILE && fd.type != FD_PIPE_READ)
+    return -1;
+
+  kbuf = palloc_get_page (0);
+  if (kbuf == NULL)
+    return -1;
+  for (;;)
+    {
+      size_t read_amt, copied, i;
+      off_t retval;
+
+      /* How much do the remaining buffers hold, up to a page? */
+      read_amt = 0;
+      for (i = seg; i < (size_t) iovcnt && read_amt < PGSIZE; i++)
+        read_amt += iov[i].iov_len - (i == seg ? seg_ofs : 0);
+      if (read_amt > PGSIZE)
+        read_amt = PGSIZE;
+      if (read_amt == 0)
+        break;
+
+      if (fd.type == FD_STDIN)
+        {
+          for (i = 0; i < read_amt; i++)
+            kbuf[i] = input_getc ();
+          retval = read_amt;
+        }
+      else if (fd.type == FD_PIPE_READ)
+        {
+          /* Wait for data only if we have none yet. */
+          retval = pipe_read (fd.pipe, &kbuf, read_amt, bytes_read == 0);
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_read (fd.file, kbuf, read_amt);
+          lock_release (&filesys_lock);
+        }
+
+      /* Check for error. */
+      if (retval < 0)
+        {
+          if (bytes_read == 0)
+            bytes_read = -1;
+          break;
+        }
+
+      /* Scatter to the user buffers. */
+      for (copied = 0; copied < (size_t) retval; )
+        {
+          size_t n = iov[seg].iov_len - seg_ofs;
+          if (n > retval - copied)
+            n = retval - copied;
+          if (!copy_to_user ((uint8_t *) iov[seg].iov_base + seg_ofs,
+                             kbuf + copied, n))
+            {
+              palloc_free_page (kbuf);
+              thread_exit ();
+            }
+          copied += n;
+          seg_ofs += n;
+          if (seg_ofs == iov[seg].iov_len)
+            {
+              seg++;
+              seg_ofs = 0;
+            }
+        }
+      bytes_read += retval;
+
+      /* If it was a short read we're done. */
+      if (retval != (off_t) read_amt)
+        break;
+    }
+  palloc_free_page (kbuf);
+
+  return bytes_read;
+}
+
+/* Writes the IOVCNT user buffers in IOV, which is in kernel
+   memory, to HANDLE.  The buffers are gathered into a kernel
+   buffer up to a page at a time and written from there with one
+   call to the file system or the console, so that many small
+   buffers cost no more than one big one.
+   Returns the number of bytes written, or -1 on error. */
+static int
+write_iov (int handle, const struct iovec *iov, int iovcnt)
+{
+  struct fd fd = *lookup_fd (handle);
+  size_t seg = 0, seg_ofs = 0;
+  uint8_t *kbuf;
+  int bytes_written = 0;
+
+  if (fd.type != FD_STDOUT && fd.type != FD_FILE && fd.type != FD_PIPE_WRITE)
+    return -1;
+
+  kbuf = palloc_get_page (0);
+  if (kbuf == NULL)
+    return -1;
+  for (;;)
+    {
+      size_t write_amt = 0;
+      off_t retval;
+
+      /* Gather up to a page from the user buffers. */
+      while (write_amt < PGSIZE && seg < (size_t) iovcnt)
+        {
+          size_t n = iov[seg].iov_len - seg_ofs;
+          if (n > PGSIZE - write_amt)
+            n = PGSIZE - write_amt;
+          if (!copy_from_user (kbuf + write_amt,
+                               (uint8_t *) iov[seg].iov_base + seg_ofs, n))
+            {
+              palloc_free_page (kbuf);
+              thread_exit ();
+            }
+          write_amt += n;
+          seg_ofs += n;
+          if (seg_ofs == iov[seg].iov_len)
+            {
+              seg++;
+              seg_ofs = 0;
+            }
+        }
+      if (write_amt == 0)
+        break;
+
+      if (fd.type == FD_STDOUT)
+        {
+          putbuf ((const char *) kbuf, write_amt);
+          retval = write_amt;
+        }
+      else if (fd.type == FD_PIPE_WRITE)
+        {
+          /* The pipe may keep a whole page, so get a new one. */
+          retval = pipe_write (fd.pipe, &kbuf, write_amt);
+          if (kbuf == NULL)
+            kbuf = palloc_get_page (0);
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (fd.file, kbuf, write_amt);
+          lock_release (&filesys_lock);
+        }
+
+      /* Handle return value. */
+      if (retval < 0)
+        {
+          if (bytes_written == 0)
+            bytes_written = -1;
+          break;
+        }
+      bytes_written += retval;
+
+      /* If it was a short write, or we could not replace a page
+         handed to a pipe, we're done. */
+      if (retval != (off_t) write_amt || kbuf == NULL)
+        break;
+    }
+  palloc_free_page (kbuf);
+
+  return bytes_written;
+}
+
+/* Read system call. */
+static int
+sys_read (int handle, void *udst, unsigned size)
+{
+  struct iovec iov;
+
+  iov.iov_base = udst;
+  iov.iov_len = size;
+  return read_iov (handle, &iov, 1);
+}
+
+/* Write system call. */
+static int
+sys_write (int handle, const void *usrc, unsigned size)
+{
+  struct iovec iov;
+
+  iov.iov_base = (void *) usrc;
+  iov.iov_len = size;
+  return write_iov (handle, &iov, 1);
+}
+
+/* Copies the IOVCNT-element I/O vector at user address UIOV into
+   IOV, all at once, and checks that its total length fits in
+   the return value.  Returns true if successful, false if the
+   vector is invalid.  Terminates the process if UIOV is a bad
+   pointer. */
+static bool
+copy_in_iov (struct iovec iov[IOV_MAX], const struct iovec *uiov, int iovcnt)
+{
+  size_t total = 0;
+  int i;
+
+  if (iovcnt <= 0 || iovcnt > IOV_MAX)
+    return false;
+  copy_in (iov, uiov, sizeof *iov * iovcnt);
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len > INT_MAX - total)
+        return false;
+      total += iov[i].iov_len;
+    }
+  return true;
+}
+
+/* Readv system call. */
+static int
+sys_readv (int handle, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+
+  if (!copy_in_iov (iov, uiov, iovcnt))
+    return -1;
+  return read_iov (handle, iov, iovcnt);
+}
+
+/* Writev system call. */
+static int
+sys_writev (int handle, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+
+  if (!copy_in_iov (iov, uiov, iovcnt))
+    return -1;
+  return write_iov (handle, iov, iovcnt);
+}
+
+/* Ring_setup system call. */
+static int
+sys_ring_setup (size_t buf_pages, struct ring_params *uparams)
+{
+  struct ring_params params;
+
+  if (!ring_setup (buf_pages, &params))
+    return false;
+  if (!copy_to_user (uparams, &params, sizeof params))
+    thread_exit ();
+  return true;
+}
+
+/* Ring_enter system call. */
+static int
+sys_ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  return ring_enter (to_submit, min_complete);
+}
+
+/* Shm_create system call. */
+static int
+sys_shm_create (const char *uname, size_t page_cnt)
+{
+  char *kname = copy_in_string (uname);
+  bool ok = shm_create (kname, page_cnt);
+
+  palloc_free_page (kname);
+  return ok;
+}
+
+/* Shm_attach system call. */
+static int
+sys_shm_attach (const char *uname, void *addr)
+{
+  char *kname = copy_in_string (uname);
+  void *base = shm_attach (kname, addr);
+
+  palloc_free_page (kname);
+  return (int) base;
+}
+
+/* Shm_detach system call. */
+static int
+sys_shm_detach (void *addr)
+{
+  return shm_detach (addr);
+}
+
+/* Seek system call. */
+static int
+sys_seek (int handle, unsigned position)
+{
+  struct file *file = lookup_file (handle);
+
+  lock_acquire (&filesys_lock);
+  if ((off_t) position >= 0)
+    file_seek (file, position);
+  lock_release (&filesys_lock);
+
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (int handle)
+{
+  struct file *file = lookup_file (handle);
+  unsigned position;
+
+  lock_acquire (&filesys_lock);
+  position = file_tell (file);
+  lock_release (&filesys_lock);
+
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (int handle)
+{
+  release_fd (lookup_fd (handle));
+  bitmap_reset (thread_current ()->fd_map, handle);
+  return 0;
+}
+
+/* Pipe system call. */
+static int
+sys_pipe (int *uhandles)
+{
+  struct fd fd;
+  int handles[2];
+
+  fd.pipe = pipe_create ();
+  if (fd.pipe == NULL)
+    return false;
+
+  fd.type = FD_PIPE_READ;
+  handles[0] = install_fd (&fd);
+  if (handles[0] < 0)
+    {
+      pipe_close (fd.pipe, false);
+      pipe_close (fd.pipe, true);
+      return false;
+    }
+  fd.type = FD_PIPE_WRITE;
+  handles[1] = install_fd (&fd);
+  if (handles[1] < 0)
+    {
+      pipe_close (fd.pipe, true);
+      sys_close (handles[0]);
+      return false;
+    }
+
+  if (!copy_to_user (uhandles, handles, sizeof handles))
+    thread_exit ();
+  return true;
+}
+
+/* Dup system call. */
+static int
+sys_dup (int handle)
+{
+  struct fd fd = *lookup_fd (handle);
+  int new_handle;
+
+  retain_fd (&fd);
+  new_handle = install_fd (&fd);
+  if (new_handle < 0)
+    release_fd (&fd);
+  return new_handle;
+}
+
+/* Dup2 system call. */
+static int
+sys_dup2 (int handle, int new_handle)
+{
+  struct thread *cur = thread_current ();
+  struct fd fd = *lookup_fd (handle);
+
+  if (new_handle < 0 || new_handle >= FD_MAX)
+    return -1;
+  if (new_handle == handle)
+    return new_handle;
+  if ((size_t) new_handle >= bitmap_size (cur->fd_map)
+      && !grow_fds (cur, new_handle))
+    return -1;
+
+  retain_fd (&fd);
+  if (bitmap_test (cur->fd_map, new_handle))
+    release_fd (&cur->fds[new_handle]);
+  cur->fds[new_handle] = fd;
+  bitmap_mark (cur->fd_map, new_handle);
+  return new_handle;
+}
+
+#ifdef VM
+/* Binds a mapping id to a region of memory and a file. */
+struct mapping
   {
-  	printf("system call! number: %d\n", intr_num);
-  	thread_exit ();
-  }
-}
-
-static void write_handler(struct intr_frame *f)
-{
-	int *stack_ptr = (int *)(f->esp);
-	int fd = *(stack_ptr+1);
-	void *buf = (void *)(*(stack_ptr+2));
-	int size = *(stack_ptr+3);
-	if(fd == 1)
-	{
-		printf("writing\n");
-		putbuf((char *)buf, size);
-		return;
-	}
+    struct list_elem elem;      /* List element. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* File. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+/* Returns the mapping associated with the given handle.
+   Terminates the process if HANDLE is not associated with a
+   memory mapping. */
+static struct mapping *
+lookup_mapping (int handle)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        return m;
+    }
+
+  thread_exit ();
+}
+
+/* Removes mapping M from the virtual address space,
+   writing back any pages that have changed. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  list_remove (&m->elem);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + PGSIZE * i);
+
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  free (m);
+}
+
+/* Mmap system call. */
+static int
+sys_mmap (int handle, void *addr)
+{
+  struct file *file = lookup_file (handle);
+  struct thread *cur = thread_current ();
+  struct mapping *m;
+  off_t offset, length;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  m->handle = cur->next_handle++;
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  lock_release (&filesys_lock);
+  if (m->file == NULL)
+    {
+      free (m);
+      return -1;
+    }
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&cur->mappings, &m->elem);
+
+  for (offset = 0; offset < length; offset += PGSIZE)
+    {
+      uint8_t *upage = m->base + offset;
+      struct page *p;
+
+      if (upage >= (uint8_t *) PHYS_BASE - STACK_MAX
+          || pagedir_get_large (cur->pagedir, upage) != NULL
+          || (p = page_allocate (upage, false)) == NULL)
+        {
+          unmap (m);
+          return -1;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = offset;
+      p->file_bytes = length - offset >= PGSIZE ? PGSIZE : length - offset;
+      m->page_cnt++;
+    }
+  if (m->page_cnt == 0)
+    {
+      unmap (m);
+      return -1;
+    }
+  return m->handle;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping)
+{
+  unmap (lookup_mapping (mapping));
+  return 0;
+}
+#else /* !VM */
+/* Mmap system call.  Mapping files requires virtual memory. */
+static int
+sys_mmap (int handle UNUSED, void *addr UNUSED)
+{
+  return -1;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping UNUSED)
+{
+  return 0;
+}
+#endif /* !VM */
+
+/* Chdir system call.  This file system has only the root
+   directory, so there is nowhere else to go. */
+static int
+sys_chdir (const char *udir)
+{
+  palloc_free_page (copy_in_string (udir));
+  return false;
+}
+
+/* Mkdir system call.  This file system has only the root
+   directory. */
+static int
+sys_mkdir (const char *udir)
+{
+  palloc_free_page (copy_in_string (udir));
+  return false;
+}
+
+/* Readdir system call.  No file descriptor refers to a
+   directory. */
+static int
+sys_readdir (int handle, char *uname UNUSED)
+{
+  lookup_fd (handle);
+  return false;
+}
+
+/* Isdir system call. */
+static int
+sys_isdir (int handle)
+{
+  lookup_fd (handle);
+  return false;
+}
+
+/* Inumber system call. */
+static int
+sys_inumber (int handle)
+{
+  return inode_get_inumber (file_get_inode (lookup_file (handle)));
+}
+
+/* Sbrk system call. */
+static int
+sys_sbrk (intptr_t increment)
+{
+  return (int) process_sbrk (increment);
+}
+
+/* Memusage system call. */
+static int
+sys_memusage (void *uusage UNUSED)
+{
+#ifdef VM
+  struct memusage u;
+
+  frame_get_usage (&u);
+  if (!copy_to_user (uusage, &u, sizeof u))
+    thread_exit ();
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* On thread exit, close all open files, unmap all mappings, and
+   tear down any I/O rings. */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+#ifdef VM
+  struct list_elem *e, *next;
+#endif
+
+  if (cur->fds != NULL)
+    {
+      size_t handle = 0;
+
+      while ((handle = bitmap_scan (cur->fd_map, handle, 1, true))
+             != BITMAP_ERROR)
+        release_fd (&cur->fds[handle++]);
+      free (cur->fds);
+      bitmap_destroy (cur->fd_map);
+      cur->fds = NULL;
+      cur->fd_map = NULL;
+    }
+
+#ifdef VM
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = next)
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      next = list_next (e);
+      unmap (m);
+    }
+#endif
+
+  ring_exit ();
+  shm_exit ();
 }
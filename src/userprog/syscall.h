@@ -1,6 +1,20 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include "threads/synch.h"
+
+struct thread;
+
+/* Serializes access to the file system. */
+extern struct lock filesys_lock;
+
 void syscall_init (void);
+void syscall_exit (void);
+bool syscall_inherit_fds (struct thread *parent);
+
+/* Fast system call entry (sysenter.S). */
+void sysenter_entry (void);
+int syscall_fast (const void *usp);
 
 #endif /* userprog/syscall.h */
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -75,6 +76,42 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Model-specific registers that configure SYSENTER.  See
+   [IA32-v3a] 4.8.7 "Performing Fast Calls to System Procedures
+   with the SYSENTER and SYSEXIT Instructions". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr"
+                : : "c" (msr), "a" ((uint32_t) value),
+                    "d" ((uint32_t) (value >> 32)));
+}
+
+/* Returns true if the CPU supports SYSENTER and SYSEXIT,
+   false otherwise.  lib/user/syscall.c makes the same check. */
+static bool
+sysenter_supported (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+
+  /* The earliest Pentium Pros report the SEP feature flag
+     without supporting the instructions. */
+  if (family == 6 && model < 3 && stepping < 3)
+    return false;
+  return (edx & (1u << 11)) != 0;
+}
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -86,6 +123,17 @@ tss_init (void)
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
+
+  /* SYSENTER loads ESP from an MSR, which would have to be
+     rewritten on every thread switch.  Instead, it points to our
+     esp0, which tss_update() already keeps current, and
+     sysenter_entry loads the kernel stack pointer from there. */
+  if (sysenter_supported ())
+    {
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_ESP, (uintptr_t) &tss->esp0);
+      wrmsr (MSR_SYSENTER_EIP, (uintptr_t) sysenter_entry);
+    }
 }
 
 /* Returns the kernel TSS. */
@@ -0,0 +1,137 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Access to user memory.
+
+   The kernel reads and writes user memory directly, without
+   first checking that it is mapped.  Each instruction below that
+   touches user memory has an entry in the exception table, the
+   __ex_table section, that gives the address of its fixup code.
+   If the access faults and the page fault handler cannot bring
+   in the page, it resumes execution at the fixup code instead of
+   killing the kernel, and the function returns an error.
+
+   The only check made up front is that the whole range lies
+   below PHYS_BASE, so that a process cannot get the kernel to
+   access kernel memory on its behalf.  Thus, for valid
+   pointers, checking costs almost nothing. */
+
+/* An exception table entry. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+/* The exception table, gathered by the linker script. */
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Adds an exception table entry that resumes at label FIXUP if
+   the instruction at label INSN faults. */
+#define EX_ENTRY(INSN, FIXUP)                   \
+        ".section __ex_table, \"a\"\n"          \
+        ".long " INSN ", " FIXUP "\n"           \
+        ".previous\n"
+
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user virtual memory. */
+static inline bool
+user_range_ok (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Reads a byte at user virtual address UADDR.
+   Returns the byte value if successful, -1 if UADDR is not a
+   valid user address. */
+int
+get_user (const uint8_t *uaddr)
+{
+  int result = -1;
+
+  if (!is_user_vaddr (uaddr))
+    return -1;
+  asm volatile ("1: movzbl %1, %0\n"
+                "2:\n"
+                EX_ENTRY ("1b", "2b")
+                : "+r" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST.
+   Returns true if successful, false if UDST is not a valid,
+   writable user address. */
+bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int ok = 0;
+
+  if (!is_user_vaddr (udst))
+    return false;
+  asm volatile ("1: movb %b2, %1\n"
+                "movl $1, %0\n"
+                "2:\n"
+                EX_ENTRY ("1b", "2b")
+                : "+r" (ok), "=m" (*udst) : "q" (byte));
+  return ok;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.
+   Returns true if successful, false if any of the user accesses
+   are invalid, in which case some bytes may have been copied. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  size_t left = size;
+
+  if (!user_range_ok (usrc, size))
+    return false;
+
+  /* A fault partway through leaves the count of bytes not yet
+     copied in ECX. */
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_ENTRY ("1b", "2b")
+                : "+c" (left), "+S" (usrc), "+D" (dst) : : "memory");
+  return left == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.
+   Returns true if successful, false if any of the user accesses
+   are invalid, in which case some bytes may have been copied. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  size_t left = size;
+
+  if (!user_range_ok (udst, size))
+    return false;
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_ENTRY ("1b", "2b")
+                : "+c" (left), "+S" (src), "+D" (udst) : : "memory");
+  return left == 0;
+}
+
+/* Called by the page fault handler for a fault in kernel code
+   that it could not resolve.  If the faulting instruction is in
+   the exception table, arranges for F to resume at its fixup
+   code and returns true.  Otherwise returns false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}
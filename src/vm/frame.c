@@ -0,0 +1,475 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <memusage.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "vm/policy.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Frame table.
+
+   At startup the frame table takes every page in the user pool
+   for itself, plus all of high memory, so that each user frame
+   has exactly one `struct frame' for its whole lifetime.  A
+   frame in high memory is not in the kernel's direct map, so
+   code that touches a frame's contents maps it with kmap()
+   first.  Frames not in use by any
+   process are kept on a free list so that allocation takes
+   constant time.  Frames in use are handed to the page
+   replacement policy selected with -evict (see policy.c), which
+   chooses victims for eviction when the free list runs out.
+
+   Every AGE_TICKS timer ticks, the "ager" kernel thread samples
+   and clears the accessed bit of each frame in use and shifts
+   it into the top of the frame's 8-bit age.  A frame whose age
+   is nonzero, because it has been accessed in the last 8
+   samples, is part of its process's working set, counted in the
+   process's `ws_pages' member.
+
+   Each process may also have resident set limits, set for every
+   process with -rss.  A process at its hard limit that needs a
+   frame must give up one of its own.  While any process is over
+   its soft limit, eviction takes frames only from such
+   processes, if it can, so that a process that stays within its
+   soft limit keeps its pages at the expense of those that do
+   not. */
+
+/* Timer ticks between samples of the accessed bits. */
+#define AGE_TICKS (TIMER_FREQ / 10)
+
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Protects the free list, the members of struct frame owned by
+   this file, and the replacement policy's state. */
+static struct lock scan_lock;
+static struct list free_frames;
+
+/* Raised by the timer to wake up the ager. */
+static struct semaphore age_sema;
+
+/* -rss: Resident set limits for new processes, in pages, or 0
+   for no limit. */
+size_t rss_soft_limit;
+size_t rss_hard_limit;
+
+/* Number of processes over their soft limits.  Protected by
+   scan_lock. */
+static size_t over_soft_cnt;
+
+/* Frames that the replacement policy may choose as victims. */
+enum victim_filter
+  {
+    VICTIM_ANY,                 /* Any frame. */
+    VICTIM_OVER_SOFT,           /* Frames of processes over soft limit. */
+    VICTIM_OWN                  /* Frames of the current process. */
+  };
+
+/* Filter in effect while scan_lock is held.  See
+   frame_eligible(). */
+static enum victim_filter victim_filter;
+
+/* Statistics. */
+static long long evict_cnt;     /* # of frames evicted. */
+
+static thread_func ager NO_RETURN;
+
+/* Adds the page at physical address PADDR to the frame table as
+   a free frame. */
+static void
+add_frame (uintptr_t paddr)
+{
+  struct frame *f = &frames[frame_cnt++];
+  lock_init (&f->lock);
+  f->paddr = paddr;
+  f->page = NULL;
+  f->age = 0;
+  f->referenced = false;
+  f->working = false;
+  f->ksm_hash = 0;
+  f->ksm_listed = false;
+  list_push_back (&free_frames, &f->elem);
+}
+
+/* Initializes the frame table.  Frames in the direct map go on
+   the free list ahead of those in high memory, so that they are
+   used first. */
+void
+frame_init (void)
+{
+  void *base;
+  size_t i;
+
+  lock_init (&scan_lock);
+  list_init (&free_frames);
+  sema_init (&age_sema, 0);
+
+  frames = malloc (sizeof *frames * (init_ram_pages + init_high_pages));
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    add_frame (vtop (base));
+  for (i = 0; i < init_high_pages; i++)
+    add_frame ((init_ram_pages + i) * PGSIZE);
+
+  frame_policy->init (frame_cnt);
+}
+
+/* Starts the ager thread. */
+void
+frame_start (void)
+{
+  thread_create ("ager", PRI_MAX, ager, NULL);
+}
+
+/* Called by the timer interrupt handler at each timer tick. */
+void
+frame_tick (void)
+{
+  if (timer_ticks () % AGE_TICKS == 0)
+    sema_up (&age_sema);
+}
+
+/* Brings the working set count of in-use frame F's process up
+   to date with F's age.  F must be locked and scan_lock must be
+   held. */
+static void
+update_working_set (struct frame *f)
+{
+  bool working = f->age != 0;
+  if (working != f->working)
+    {
+      if (working)
+        f->page->thread->ws_pages++;
+      else
+        f->page->thread->ws_pages--;
+      f->working = working;
+    }
+}
+
+/* Adds DELTA to the resident set size of process T.  scan_lock
+   must be held. */
+static void
+charge (struct thread *t, int delta)
+{
+  bool was_over = t->rss_soft != 0 && t->rss_pages > t->rss_soft;
+  bool is_over;
+
+  t->rss_pages += delta;
+  is_over = t->rss_soft != 0 && t->rss_pages > t->rss_soft;
+  if (is_over != was_over)
+    {
+      if (is_over)
+        over_soft_cnt++;
+      else
+        over_soft_cnt--;
+    }
+}
+
+/* Shifts one sample of the accessed bit into the age of each
+   frame in use and passes it along to the replacement policy.
+   Frames locked by someone else are skipped for this round. */
+static void
+age_frames (void)
+{
+  size_t i;
+
+  lock_acquire (&scan_lock);
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+
+      if (f->page == NULL || !lock_try_acquire (&f->lock))
+        continue;
+
+      f->age >>= 1;
+      if (page_accessed_recently (f->page))
+        {
+          f->age |= AGE_TOP;
+          f->referenced = true;
+        }
+      update_working_set (f);
+      frame_policy->sample (f);
+      lock_release (&f->lock);
+    }
+  lock_release (&scan_lock);
+}
+
+/* Ager thread. */
+static void
+ager (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&age_sema);
+
+      /* If we fell behind, catch up with a single sample. */
+      while (sema_try_down (&age_sema))
+        continue;
+
+      age_frames ();
+    }
+}
+
+/* Returns true if the replacement policy may choose in-use
+   frame F as a victim.  Used by replacement policies.  scan_lock
+   must be held. */
+bool
+frame_eligible (struct frame *f)
+{
+  struct thread *t = f->page->thread;
+
+  switch (victim_filter)
+    {
+    case VICTIM_OVER_SOFT:
+      return t->rss_soft != 0 && t->rss_pages > t->rss_soft;
+    case VICTIM_OWN:
+      return t == thread_current ();
+    default:
+      return true;
+    }
+}
+
+/* Evicts a frame chosen by the replacement policy among those
+   that FILTER allows, and returns it locked.  Returns a null
+   pointer if no frame could be evicted.  scan_lock must be held
+   on entry; it is released and reacquired while the victim is
+   written out. */
+static struct frame *
+evict (enum victim_filter filter)
+{
+  struct frame *f;
+  struct page *victim;
+  struct thread *owner;
+  bool evicted;
+
+  victim_filter = filter;
+  f = frame_policy->pick_victim ();
+  victim_filter = VICTIM_ANY;
+  if (f == NULL)
+    return NULL;
+
+  /* The victim's owner may exit as soon as page_out() detaches
+     it from F, so settle its accounting first. */
+  victim = f->page;
+  owner = victim->thread;
+  f->age = 0;
+  update_working_set (f);
+  charge (owner, -1);
+  owner->evict_cnt++;
+
+  /* Don't hold scan_lock across swap I/O. */
+  lock_release (&scan_lock);
+  evicted = page_out (victim);
+  lock_acquire (&scan_lock);
+
+  if (evicted)
+    {
+      evict_cnt++;
+      return f;
+    }
+
+  owner->evict_cnt--;
+  charge (owner, 1);
+  f->age = AGE_TOP;
+  update_working_set (f);
+  frame_policy->insert (f);
+  lock_release (&f->lock);
+  return NULL;
+}
+
+/* Allocates and locks a frame for PAGE.  If no frame is free
+   and MAY_EVICT is true, evicts a page to make room.  If PAGE's
+   process is at its hard resident limit, evicts one of its own
+   pages instead, or fails if MAY_EVICT is false.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *
+frame_alloc_and_lock (struct page *page, bool may_evict)
+{
+  struct thread *t = page->thread;
+  struct frame *f = NULL;
+
+  lock_acquire (&scan_lock);
+  if (t->rss_hard != 0 && t->rss_pages >= t->rss_hard)
+    {
+      /* If every frame of the process is locked, let it go over
+         the limit rather than fail. */
+      if (may_evict)
+        f = evict (VICTIM_OWN);
+      else
+        {
+          lock_release (&scan_lock);
+          return NULL;
+        }
+    }
+  if (f == NULL && !list_empty (&free_frames))
+    {
+      f = list_entry (list_pop_front (&free_frames), struct frame, elem);
+      lock_acquire (&f->lock);
+    }
+  if (f == NULL && may_evict)
+    {
+      if (over_soft_cnt > 0)
+        f = evict (VICTIM_OVER_SOFT);
+      if (f == NULL)
+        f = evict (VICTIM_ANY);
+    }
+
+  if (f != NULL)
+    {
+      f->page = page;
+      f->age = AGE_TOP;
+      f->referenced = false;
+      update_working_set (f);
+      charge (t, 1);
+      frame_policy->insert (f);
+    }
+  lock_release (&scan_lock);
+
+  return f;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but never inserted. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Releases frame F for use by another page.
+   F must be locked for use by the current process.
+   Any data in F is lost. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  lock_acquire (&scan_lock);
+  frame_policy->remove (f);
+  f->age = 0;
+  update_working_set (f);
+  charge (f->page->thread, -1);
+  f->page = NULL;
+  list_push_front (&free_frames, &f->elem);
+  lock_release (&scan_lock);
+
+  lock_release (&f->lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/* Takes frame F away from its page, leaving it in the caller's
+   hands until it is passed to frame_release().  The frame is
+   not evicted or aged meanwhile.  F must be locked for use by
+   the current process; it is unlocked. */
+void
+frame_detach (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  lock_acquire (&scan_lock);
+  frame_policy->remove (f);
+  f->age = 0;
+  update_working_set (f);
+  charge (f->page->thread, -1);
+  f->page = NULL;
+  lock_release (&scan_lock);
+
+  lock_release (&f->lock);
+}
+
+/* Returns frame F, detached with frame_detach(), to the free
+   list.  Any data in F is lost. */
+void
+frame_release (struct frame *f)
+{
+  ASSERT (f->page == NULL);
+
+  lock_acquire (&scan_lock);
+  list_push_front (&free_frames, &f->elem);
+  lock_release (&scan_lock);
+}
+
+/* Returns the number of user frames. */
+size_t
+frame_count (void)
+{
+  return frame_cnt;
+}
+
+/* Returns user frame number IDX, which must be less than
+   frame_count().  The frame may be free or in use. */
+struct frame *
+frame_at (size_t idx)
+{
+  ASSERT (idx < frame_cnt);
+  return &frames[idx];
+}
+
+/* Returns true if in-use frame F has been accessed since the
+   last call for F, false otherwise.  Used by replacement
+   policies.  F must be locked and scan_lock must be held. */
+bool
+frame_referenced (struct frame *f)
+{
+  bool referenced = f->referenced;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  f->referenced = false;
+  if (page_accessed_recently (f->page))
+    {
+      f->age |= AGE_TOP;
+      update_working_set (f);
+      referenced = true;
+    }
+  return referenced;
+}
+
+/* Stores the current process's memory usage in *U. */
+void
+frame_get_usage (struct memusage *u)
+{
+  struct thread *t = thread_current ();
+
+  lock_acquire (&scan_lock);
+  u->resident = t->rss_pages;
+  u->working_set = t->ws_pages;
+  u->soft_limit = t->rss_soft;
+  u->hard_limit = t->rss_hard;
+  u->faults = t->fault_cnt;
+  u->evictions = t->evict_cnt;
+  lock_release (&scan_lock);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu user frames, %lld evictions, %s policy\n",
+          frame_cnt, evict_cnt, frame_policy->name);
+}
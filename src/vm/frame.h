@@ -0,0 +1,65 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct page;
+struct memusage;
+
+/* A physical frame from the user pool. */
+struct frame
+  {
+    struct lock lock;           /* Prevent simultaneous access. */
+    uintptr_t paddr;            /* Physical address; see kmap(). */
+    struct page *page;          /* Mapped process page, if any. */
+
+    /* Owned by frame.c, protected by its scan_lock. */
+    uint8_t age;                /* Recent accesses, newest in top bit. */
+    bool referenced;            /* Accessed since policy last checked? */
+    bool working;               /* In the working set? */
+
+    /* Owned by the replacement policy, protected by scan_lock. */
+    int queue;                  /* Policy list that ELEM is on. */
+    struct list_elem elem;      /* Free list or a policy list. */
+
+    /* Owned by ksm.c, protected by its ksm_lock. */
+    unsigned ksm_hash;          /* Hash of contents when last scanned. */
+    bool ksm_listed;            /* In the unstable set? */
+    struct hash_elem ksm_elem;  /* Unstable set element. */
+  };
+
+/* Age bit set by an access. */
+#define AGE_TOP 0x80
+
+/* -rss: Resident set limits for new processes, or 0. */
+extern size_t rss_soft_limit;
+extern size_t rss_hard_limit;
+
+void frame_init (void);
+void frame_start (void);
+void frame_tick (void);
+
+struct frame *frame_alloc_and_lock (struct page *, bool may_evict);
+void frame_lock (struct page *);
+
+void frame_free (struct frame *);
+void frame_unlock (struct frame *);
+void frame_detach (struct frame *);
+void frame_release (struct frame *);
+
+size_t frame_count (void);
+struct frame *frame_at (size_t);
+
+bool frame_referenced (struct frame *);
+bool frame_eligible (struct frame *);
+
+void frame_get_usage (struct memusage *);
+
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
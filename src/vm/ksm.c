@@ -0,0 +1,392 @@
+#include "vm/ksm.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+#include "userprog/pagedir.h"
+
+/* Same-page merging.
+
+   When enabled with -ksm, the "ksmd" kernel thread visits the
+   user frames in turn, up to ksm_pages_per_sec of them per
+   second, and hashes each frame's contents with hash_bytes().
+
+   A frame whose hash changed since the previous visit is
+   probably still being written, so it is left alone.  Otherwise
+   the frame is looked up among the "stable" nodes, which are
+   shared read-only copies.  If a node holds the same contents,
+   the page is mapped read-only to the node's copy and its own
+   frame is freed.  If not, the frame is looked up among the
+   "unstable" candidates seen earlier in the current pass, and
+   if one holds the same contents, that candidate's frame
+   becomes a new stable node shared by both pages.  Otherwise,
+   the frame becomes a candidate itself.
+
+   A write to a merged page faults, and the page then receives a
+   private copy (see do_page_in() in page.c).  Merged pages hold
+   no frame of their own, so they are never evicted; a node's
+   frame returns to the frame table when its last page goes
+   away. */
+
+/* Timer ticks between rounds of scanning. */
+#define SCAN_TICKS (TIMER_FREQ / 10)
+
+unsigned ksm_pages_per_sec;
+
+/* Protects everything below, and the ksm_* members of each
+   struct frame. */
+static struct lock ksm_lock;
+static struct hash stable_nodes;        /* struct ksm_node's. */
+static struct hash unstable_frames;     /* Candidate struct frame's. */
+
+/* Next frame to scan. */
+static size_t scan_idx;
+
+/* Raised by the timer to wake up ksmd. */
+static struct semaphore scan_sema;
+
+/* Statistics. */
+static long long scan_cnt;      /* # of frames scanned. */
+static size_t node_cnt;         /* # of stable nodes. */
+static size_t merged_cnt;       /* # of pages mapping stable nodes. */
+
+static thread_func ksmd NO_RETURN;
+
+/* Compares the contents of frames A and B, like memcmp(). */
+static int
+compare_frames (struct frame *a, struct frame *b)
+{
+  void *a_page = kmap (a->paddr);
+  void *b_page = kmap (b->paddr);
+  int cmp = memcmp (a_page, b_page, PGSIZE);
+  kunmap (b_page);
+  kunmap (a_page);
+  return cmp;
+}
+
+/* Returns a hash value for the stable node that E refers to. */
+static unsigned
+node_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct ksm_node, elem)->hash;
+}
+
+/* Returns true if stable node A's contents precede B's. */
+static bool
+node_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct ksm_node *a = hash_entry (a_, struct ksm_node, elem);
+  const struct ksm_node *b = hash_entry (b_, struct ksm_node, elem);
+
+  if (a->hash != b->hash)
+    return a->hash < b->hash;
+  return compare_frames (a->frame, b->frame) < 0;
+}
+
+/* Returns a hash value for the candidate frame that E refers
+   to. */
+static unsigned
+candidate_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct frame, ksm_elem)->ksm_hash;
+}
+
+/* Returns true if candidate frame A's hash is less than B's.
+   Only one candidate is kept per hash value. */
+static bool
+candidate_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, ksm_elem);
+  const struct frame *b = hash_entry (b_, struct frame, ksm_elem);
+
+  return a->ksm_hash < b->ksm_hash;
+}
+
+/* Initializes same-page merging. */
+void
+ksm_init (void)
+{
+  lock_init (&ksm_lock);
+  hash_init (&stable_nodes, node_hash, node_less, NULL);
+  hash_init (&unstable_frames, candidate_hash, candidate_less, NULL);
+  sema_init (&scan_sema, 0);
+}
+
+/* Starts the ksmd thread, if merging is enabled. */
+void
+ksm_start (void)
+{
+  if (ksm_pages_per_sec > 0)
+    thread_create ("ksmd", PRI_DEFAULT, ksmd, NULL);
+}
+
+/* Called by the timer interrupt handler at each timer tick. */
+void
+ksm_tick (void)
+{
+  if (ksm_pages_per_sec > 0 && timer_ticks () % SCAN_TICKS == 0)
+    sema_up (&scan_sema);
+}
+
+/* Drops candidate F from the unstable set, if it is there. */
+static void
+unlist (struct frame *f)
+{
+  if (f->ksm_listed)
+    {
+      hash_delete (&unstable_frames, &f->ksm_elem);
+      f->ksm_listed = false;
+    }
+}
+
+/* Marks frame F as no longer a candidate.  Used as a callback
+   for hash_clear(). */
+static void
+unlist_elem (struct hash_elem *e, void *aux UNUSED)
+{
+  hash_entry (e, struct frame, ksm_elem)->ksm_listed = false;
+}
+
+/* Unmaps in-use page P, whose frame must be locked, so that it
+   cannot change while it is compared and merged.  A dirty page
+   no longer matches its file, so from now on it must be written
+   to swap if it is evicted. */
+static void
+protect (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+
+  if (pagedir_is_dirty (pd, p->addr))
+    p->file = NULL;
+  pagedir_clear_page (pd, p->addr);
+}
+
+/* Maps page P back to its own frame after an unsuccessful
+   merge. */
+static void
+unprotect (struct page *p)
+{
+  pagedir_set_paddr (p->thread->pagedir, p->addr, p->frame->paddr,
+                     !p->read_only);
+}
+
+/* Maps protected page P read-only to stable NODE in place of
+   its own frame. */
+static bool
+map_node (struct page *p, struct ksm_node *node)
+{
+  if (!pagedir_set_paddr (p->thread->pagedir, p->addr, node->frame->paddr,
+                          false))
+    return false;
+  p->merged = node;
+  p->frame = NULL;
+  node->refs++;
+  merged_cnt++;
+  return true;
+}
+
+/* Turns candidate frame C, which must be locked and protected
+   and hold the same contents as protected frame F, into a new
+   stable node with hash HASH, and returns the node.  C is
+   unlocked and given to the node.  Returns a null pointer on
+   failure, with C still locked and protected. */
+static struct ksm_node *
+make_node (struct frame *c, unsigned hash)
+{
+  struct page *cp = c->page;
+  struct ksm_node *node = malloc (sizeof *node);
+
+  if (node == NULL)
+    return NULL;
+  node->hash = hash;
+  node->frame = c;
+  node->refs = 0;
+
+  if (!map_node (cp, node))
+    {
+      free (node);
+      return NULL;
+    }
+  hash_insert (&stable_nodes, &node->elem);
+  node_cnt++;
+
+  unlist (c);
+  frame_detach (c);
+  return node;
+}
+
+/* Tries to merge the page in frame F, which must be locked and
+   in use, as described at the top of this file.  On success, F
+   is freed and unlocked. */
+static bool
+try_merge (struct frame *f)
+{
+  struct page *p = f->page;
+  struct ksm_node probe, *node = NULL;
+  struct hash_elem *e;
+  struct frame *c = NULL;
+
+  probe.hash = f->ksm_hash;
+  probe.frame = f;
+  e = hash_find (&stable_nodes, &probe.elem);
+  if (e != NULL)
+    node = hash_entry (e, struct ksm_node, elem);
+  else
+    {
+      struct frame key;
+      key.ksm_hash = f->ksm_hash;
+      e = hash_find (&unstable_frames, &key.ksm_elem);
+      if (e == NULL)
+        return false;
+      c = hash_entry (e, struct frame, ksm_elem);
+      if (c == f || !lock_try_acquire (&c->lock))
+        return false;
+      if (c->page == NULL || c->page->merged != NULL)
+        {
+          unlist (c);
+          lock_release (&c->lock);
+          return false;
+        }
+    }
+
+  /* Compare only once F, and candidate C if any, can no longer
+     change: ksmd can be preempted, and either owner could write
+     its page in between. */
+  protect (p);
+  if (c != NULL)
+    protect (c->page);
+  if (node != NULL ? compare_frames (node->frame, f) != 0
+      : compare_frames (c, f) != 0
+        || (node = make_node (c, f->ksm_hash)) == NULL)
+    {
+      unprotect (p);
+      if (c != NULL)
+        {
+          unprotect (c->page);
+          lock_release (&c->lock);
+        }
+      return false;
+    }
+  if (!map_node (p, node))
+    {
+      unprotect (p);
+      return false;
+    }
+
+  unlist (f);
+  frame_free (f);
+  return true;
+}
+
+/* Scans frame F, merging its page if possible. */
+static void
+scan_frame (struct frame *f)
+{
+  struct page *p;
+  void *kpage;
+  unsigned hash;
+
+  if (!lock_try_acquire (&f->lock))
+    return;
+  p = f->page;
+
+  /* A page of a mapped file must keep its own frame, so that it
+     is written back to the file. */
+  if (p == NULL || p->thread->pagedir == NULL
+      || (p->file != NULL && !p->private))
+    {
+      lock_release (&f->lock);
+      return;
+    }
+
+  scan_cnt++;
+  kpage = kmap (f->paddr);
+  hash = hash_bytes (kpage, PGSIZE);
+  kunmap (kpage);
+  if (hash != f->ksm_hash)
+    {
+      /* Changed since last time.  Try again next pass. */
+      unlist (f);
+      f->ksm_hash = hash;
+    }
+  else if (try_merge (f))
+    return;
+  else if (!f->ksm_listed && hash_insert (&unstable_frames,
+                                          &f->ksm_elem) == NULL)
+    f->ksm_listed = true;
+  lock_release (&f->lock);
+}
+
+/* Scans the next batch of frames. */
+static void
+scan (size_t batch)
+{
+  size_t frame_cnt = frame_count ();
+
+  lock_acquire (&ksm_lock);
+  while (batch-- > 0)
+    {
+      scan_frame (frame_at (scan_idx));
+      if (++scan_idx >= frame_cnt)
+        {
+          /* Start a new pass with no candidates. */
+          scan_idx = 0;
+          hash_clear (&unstable_frames, unlist_elem);
+        }
+    }
+  lock_release (&ksm_lock);
+}
+
+/* ksmd thread. */
+static void
+ksmd (void *aux UNUSED)
+{
+  size_t batch = ksm_pages_per_sec * SCAN_TICKS / TIMER_FREQ;
+  if (batch == 0)
+    batch = 1;
+
+  for (;;)
+    {
+      sema_down (&scan_sema);
+
+      /* If we fell behind, don't try to catch up. */
+      while (sema_try_down (&scan_sema))
+        continue;
+
+      scan (batch);
+    }
+}
+
+/* Releases a reference to NODE, held by a page that no longer
+   maps it.  The page's mapping must already be cleared. */
+void
+ksm_put (struct ksm_node *node)
+{
+  lock_acquire (&ksm_lock);
+  merged_cnt--;
+  if (--node->refs == 0)
+    {
+      hash_delete (&stable_nodes, &node->elem);
+      node_cnt--;
+      frame_release (node->frame);
+      free (node);
+    }
+  lock_release (&ksm_lock);
+}
+
+/* Prints same-page merging statistics. */
+void
+ksm_print_stats (void)
+{
+  printf ("KSM: %lld frames scanned, %zu pages shared, %zu pages saved\n",
+          scan_cnt, node_cnt, merged_cnt - node_cnt);
+}
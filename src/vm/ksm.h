@@ -0,0 +1,29 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+
+#include <hash.h>
+#include <stddef.h>
+
+struct frame;
+
+/* A frame shared, read-only, by every page whose contents it
+   holds.  A write to any of the pages gives that page a private
+   copy. */
+struct ksm_node
+  {
+    struct hash_elem elem;      /* Element in stable_nodes. */
+    unsigned hash;              /* hash_bytes() of the contents. */
+    struct frame *frame;        /* Frame holding the copy. */
+    size_t refs;                /* Number of pages mapping it. */
+  };
+
+/* -ksm: Pages scanned per second for merging, or 0 to disable. */
+extern unsigned ksm_pages_per_sec;
+
+void ksm_init (void);
+void ksm_start (void);
+void ksm_tick (void);
+void ksm_put (struct ksm_node *);
+void ksm_print_stats (void);
+
+#endif /* vm/ksm.h */
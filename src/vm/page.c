@@ -0,0 +1,498 @@
+#include "vm/page.h"
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/ksm.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+/* Fault-around.
+
+   A process that scans through its executable or a mapped file
+   would otherwise take one page fault per page.  Instead, when
+   a fault brings in a page, we also map up to a window's worth
+   of the following pages, as long as they belong to the same
+   mapping and are cheap to bring in, that is, they are
+   zero-filled or read from the file without any other I/O.
+
+   The window starts out at FAULT_AROUND_MIN pages.  A fault on
+   the page just past the previous window means that the
+   process is scanning sequentially, so the window doubles, up
+   to fault_around_pages.  Any other fault resets it. */
+#define FAULT_AROUND_MIN 4
+
+size_t fault_around_pages = 32;
+
+/* Shared zero frame.
+
+   Zero-fill pages that have only been read are all mapped
+   read-only to this one frame.  The first write to such a page
+   faults, and only then does the page get a private frame of
+   its own. */
+static void *zero_frame;
+
+/* Statistics. */
+static long long page_in_cnt;       /* # of pages brought in by faults. */
+static long long fault_around_cnt;  /* # of pages mapped around faults. */
+static long long zero_map_cnt;      /* # of mappings of the zero frame. */
+
+static bool do_page_in (struct page *, bool may_evict);
+static bool map_zero_frame (struct page *);
+
+/* Initializes the virtual page layer. */
+void
+page_init (void)
+{
+  zero_frame = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
+
+/* Creates and returns an empty supplemental page table, or a
+   null pointer if memory allocation fails. */
+struct hash *
+page_table_create (void)
+{
+  struct hash *pages = malloc (sizeof *pages);
+  if (pages != NULL && !hash_init (pages, page_hash, page_less, NULL))
+    {
+      free (pages);
+      pages = NULL;
+    }
+  return pages;
+}
+
+/* Writes page P, whose frame must be locked, back to its file.
+   Returns true if successful, false on failure. */
+static bool
+write_back (struct page *p)
+{
+  /* The caller may already hold the file system lock, as in
+     fill_frame(). */
+  bool held = lock_held_by_current_thread (&filesys_lock);
+  uint8_t *kpage = kmap (p->frame->paddr);
+  off_t written;
+
+  if (!held)
+    lock_acquire (&filesys_lock);
+  written = file_write_at (p->file, kpage, p->file_bytes, p->file_offset);
+  if (!held)
+    lock_release (&filesys_lock);
+  kunmap (kpage);
+  return written == p->file_bytes;
+}
+
+/* Releases page P's frame or swap slot and frees P, which must
+   belong to the current process and already be removed from its
+   page table.  A modified page of a mapped file is first written
+   back. */
+static void
+destroy_page (struct page *p)
+{
+  frame_lock (p);
+  if (p->frame != NULL)
+    {
+      uint32_t *pd = p->thread->pagedir;
+
+      pagedir_clear_page (pd, p->addr);
+      if (p->file != NULL && !p->private && pagedir_is_dirty (pd, p->addr))
+        write_back (p);
+      frame_free (p->frame);
+    }
+  else if (p->zero_mapped || p->shared)
+    pagedir_clear_page (p->thread->pagedir, p->addr);
+  else if (p->merged != NULL)
+    {
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      ksm_put (p->merged);
+    }
+  swap_free (p);
+  free (p);
+}
+
+/* Destroys a page, which must be in the current process's
+   page table.  Used as a callback for hash_destroy(). */
+static void
+destroy_page_elem (struct hash_elem *p_, void *aux UNUSED)
+{
+  destroy_page (hash_entry (p_, struct page, hash_elem));
+}
+
+/* Destroys the current process's page table, releasing all of
+   its frames. */
+void
+page_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct hash *pages = t->pages;
+
+  if (pages != NULL)
+    {
+      t->pages = NULL;
+      hash_destroy (pages, destroy_page_elem);
+      free (pages);
+    }
+}
+
+/* Returns the page containing the given virtual ADDRESS,
+   or a null pointer if no such page exists. */
+static struct page *
+page_for_addr (const void *address)
+{
+  struct thread *t = thread_current ();
+
+  if (t->pages != NULL && is_user_vaddr (address))
+    {
+      struct page p;
+      struct hash_elem *e;
+
+      p.addr = pg_round_down (address);
+      e = hash_find (t->pages, &p.hash_elem);
+      if (e != NULL)
+        return hash_entry (e, struct page, hash_elem);
+    }
+  return NULL;
+}
+
+/* Adds a mapping for user virtual address VADDR to the page
+   hash table.  Fails if VADDR is already mapped or if memory
+   allocation fails. */
+struct page *
+page_allocate (void *vaddr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+      p->read_only = read_only;
+      p->thread = t;
+      p->frame = NULL;
+      p->zero_mapped = false;
+      p->merged = NULL;
+      p->shared = false;
+      p->ghost = 0;
+      p->sector = (block_sector_t) -1;
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+      p->private = true;
+
+      if (hash_insert (t->pages, &p->hash_elem) != NULL)
+        {
+          /* Already mapped. */
+          free (p);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/* Returns true if the current process has no page in the
+   PAGE_CNT pages starting at VADDR. */
+bool
+page_range_is_free (const void *vaddr, size_t page_cnt)
+{
+  const uint8_t *upage = pg_round_down (vaddr);
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    if (page_for_addr (upage + i * PGSIZE) != NULL)
+      return false;
+  return true;
+}
+
+/* Removes the page containing VADDR from the current process's
+   page table and releases its memory.  Does nothing if VADDR
+   is not mapped. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page *p = page_for_addr (vaddr);
+  if (p != NULL)
+    {
+      hash_delete (p->thread->pages, &p->hash_elem);
+      destroy_page (p);
+    }
+}
+
+/* Returns true if page Q, which lies DISTANCE pages above page
+   P, is part of the same mapping as P and has not been swapped
+   out. */
+static bool
+same_mapping (const struct page *p, const struct page *q, size_t distance)
+{
+  if (q->shared || q->read_only != p->read_only || q->file != p->file
+      || q->sector != (block_sector_t) -1)
+    return false;
+  return (q->file == NULL
+          || q->file_offset == p->file_offset + (off_t) (distance * PGSIZE));
+}
+
+/* Maps pages following P, which was just brought in by a page
+   fault, as described at the top of this file.  Zero-fill
+   neighbors are mapped to the zero frame and the rest use only
+   free frames, so fault-around never causes other pages to be
+   evicted. */
+static void
+fault_around (struct page *p)
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  if (fault_around_pages == 0)
+    return;
+
+  if (p->addr == t->fault_next && t->fault_window > 0)
+    t->fault_window *= 2;
+  else
+    t->fault_window = FAULT_AROUND_MIN;
+  if (t->fault_window > fault_around_pages)
+    t->fault_window = fault_around_pages;
+
+  for (i = 1; i <= t->fault_window; i++)
+    {
+      struct page *q = page_for_addr ((uint8_t *) p->addr + i * PGSIZE);
+      if (q == NULL || !same_mapping (p, q, i))
+        break;
+      if (q->frame == NULL && !q->zero_mapped && q->merged == NULL)
+        {
+          if (q->file == NULL)
+            {
+              if (!map_zero_frame (q))
+                break;
+            }
+          else if (do_page_in (q, false))
+            frame_unlock (q->frame);
+          else
+            break;
+          fault_around_cnt++;
+        }
+    }
+  t->fault_next = (uint8_t *) p->addr + i * PGSIZE;
+}
+
+/* Fills P's newly allocated, locked frame, mapped at KPAGE,
+   with P's contents from its merged frame, its file, or zeros.
+   Returns true if successful, false on failure. */
+static bool
+fill_frame (struct page *p, uint8_t *kpage)
+{
+  if (p->merged != NULL)
+    {
+      uint8_t *copy = kmap (p->merged->frame->paddr);
+      memcpy (kpage, copy, PGSIZE);
+      kunmap (copy);
+    }
+  else if (p->file != NULL)
+    {
+      /* The caller may already hold the file system lock if we
+         faulted while a system call was accessing user
+         memory. */
+      bool held = lock_held_by_current_thread (&filesys_lock);
+      off_t read_bytes;
+
+      if (!held)
+        lock_acquire (&filesys_lock);
+      read_bytes = file_read_at (p->file, kpage, p->file_bytes,
+                                 p->file_offset);
+      if (!held)
+        lock_release (&filesys_lock);
+
+      if (read_bytes != p->file_bytes)
+        return false;
+      memset (kpage + read_bytes, 0, PGSIZE - read_bytes);
+    }
+  else
+    memset (kpage, 0, PGSIZE);
+  return true;
+}
+
+/* Loads page P into a newly allocated frame and maps it into
+   the owning process's page directory.  If MAY_EVICT is false,
+   only a free frame will do.
+   Returns true if successful, with P's frame locked, or false
+   on failure. */
+static bool
+do_page_in (struct page *p, bool may_evict)
+{
+  p->frame = frame_alloc_and_lock (p, may_evict);
+  if (p->frame == NULL)
+    return false;
+
+  if (p->merged == NULL && p->sector != (block_sector_t) -1)
+    swap_in (p);
+  else
+    {
+      uint8_t *kpage = kmap (p->frame->paddr);
+      bool ok = fill_frame (p, kpage);
+      kunmap (kpage);
+      if (!ok)
+        goto fail;
+    }
+
+  /* Replace the zero frame or a merged frame, if this is the
+     page's first write since it was mapped there. */
+  if (p->zero_mapped)
+    {
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      p->zero_mapped = false;
+    }
+  else if (p->merged != NULL)
+    {
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      ksm_put (p->merged);
+      p->merged = NULL;
+    }
+
+  if (!pagedir_set_paddr (p->thread->pagedir, p->addr, p->frame->paddr,
+                          !p->read_only))
+    goto fail;
+  return true;
+
+ fail:
+  frame_free (p->frame);
+  p->frame = NULL;
+  return false;
+}
+
+/* Maps zero-fill page P read-only to the shared zero frame.
+   Returns true if successful, false on failure. */
+static bool
+map_zero_frame (struct page *p)
+{
+  ASSERT (p->file == NULL);
+
+  if (!pagedir_set_page (p->thread->pagedir, p->addr, zero_frame, false))
+    return false;
+  p->zero_mapped = true;
+  zero_map_cnt++;
+  return true;
+}
+
+/* Faults in the page containing FAULT_ADDR, plus any neighbors
+   chosen by fault-around.  WRITE is true if the faulting access
+   was a write, in which case the page receives a private frame
+   even if it is zero-filled.
+   Returns true if successful, false on failure. */
+bool
+page_in (void *fault_addr, bool write)
+{
+  struct page *p = page_for_addr (fault_addr);
+  bool success = true;
+
+  if (p == NULL || p->shared || (write && p->read_only))
+    return false;
+
+  /* Wait out any eviction of the page in progress. */
+  frame_lock (p);
+  if (p->frame == NULL && !(p->merged != NULL && !write))
+    {
+      if (!write && p->file == NULL && p->sector == (block_sector_t) -1)
+        success = !p->zero_mapped && map_zero_frame (p);
+      else
+        success = do_page_in (p, true);
+      if (success)
+        {
+          page_in_cnt++;
+          p->thread->fault_cnt++;
+        }
+    }
+  if (p->frame != NULL)
+    frame_unlock (p->frame);
+
+  if (success)
+    fault_around (p);
+  return success;
+}
+
+/* Evicts page P, whose frame must be locked by the caller.
+   P's contents are written to swap unless they can be read
+   back from its file unchanged.
+   Returns true if successful, false on failure. */
+bool
+page_out (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool ok;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Mark page not present in page table, forcing accesses by the
+     process to fault.  This must happen before checking the
+     dirty bit, to prevent a race with the process dirtying the
+     page. */
+  pagedir_clear_page (pd, p->addr);
+
+  if (p->file != NULL && !p->private)
+    ok = !pagedir_is_dirty (pd, p->addr) || write_back (p);
+  else if (p->file != NULL && !pagedir_is_dirty (pd, p->addr))
+    ok = true;
+  else
+    {
+      /* Once written to swap, the page no longer comes from its
+         file. */
+      ok = swap_out (p);
+      if (ok)
+        p->file = NULL;
+    }
+
+  if (ok)
+    p->frame = NULL;
+  else
+    pagedir_set_paddr (pd, p->addr, p->frame->paddr, !p->read_only);
+  return ok;
+}
+
+/* Returns true if page P's data has been accessed recently,
+   false otherwise, and clears P's accessed bit either way.
+   P must have a frame locked by the current thread, or the
+   frame table must otherwise keep P's owner from exiting. */
+bool
+page_accessed_recently (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool was_accessed;
+
+  ASSERT (p->frame != NULL);
+
+  was_accessed = pagedir_is_accessed (pd, p->addr);
+  if (was_accessed)
+    pagedir_set_accessed (pd, p->addr, false);
+  return was_accessed;
+}
+
+/* Prints paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Paging: %lld pages faulted in, %lld mapped by fault-around, "
+          "%lld zero-frame mappings\n",
+          page_in_cnt, fault_around_cnt, zero_map_cnt);
+}
@@ -0,0 +1,58 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/* Virtual page. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool read_only;             /* Read-only page? */
+    struct thread *thread;      /* Owning thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /* struct thread `pages' hash element. */
+
+    /* Set only in owning process context. */
+    struct frame *frame;        /* Page frame. */
+    bool zero_mapped;           /* Mapped to the shared zero frame? */
+    struct ksm_node *merged;    /* Mapped to a merged frame, if any. */
+    bool shared;                /* Mapped to a shared memory segment? */
+
+    /* Owned by the replacement policy. */
+    unsigned ghost;             /* 2Q: When evicted from A1in, or 0. */
+
+    /* Swap information, protected by frame->lock. */
+    block_sector_t sector;      /* Swap slot (see swap.c), or -1. */
+
+    /* Memory-mapped file information.
+       A page with a null FILE is zero-filled on first use. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read/write, 1...PGSIZE. */
+    bool private;               /* False to write back to file,
+                                   true to write back to swap. */
+  };
+
+/* -fa: Maximum number of neighboring pages mapped on a fault. */
+extern size_t fault_around_pages;
+
+void page_init (void);
+struct hash *page_table_create (void);
+void page_exit (void);
+
+struct page *page_allocate (void *, bool read_only);
+void page_deallocate (void *vaddr);
+bool page_range_is_free (const void *vaddr, size_t page_cnt);
+bool page_in (void *fault_addr, bool write);
+bool page_out (struct page *);
+bool page_accessed_recently (struct page *);
+
+void page_print_stats (void);
+
+#endif /* vm/page.h */
@@ -0,0 +1,314 @@
+#include "vm/policy.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "threads/synch.h"
+
+/* Page replacement policies.
+
+   Each policy keeps the frames in use on lists of its own,
+   threaded through `struct frame''s `elem' member, and tags
+   each frame with the list it is on in the `queue' member.  A
+   policy learns whether a frame has been accessed by calling
+   frame_referenced(), which also clears that state, and may
+   look at the frame's `age', an 8-bit history of accesses that
+   the frame table's ager thread keeps up to date.  A policy
+   chooses a victim only among frames for which frame_eligible()
+   returns true.
+
+   "clock" keeps every frame on a single ring and sweeps a hand
+   around it, evicting the first frame not referenced since the
+   hand last passed.
+
+   "aging" approximates LRU with the frames' ages.  A frame
+   whose age reaches 0, because it has not been accessed in the
+   last 8 samples, moves from the active list to the inactive
+   list, and back again once it is accessed.  Eviction takes
+   frames from the front of the inactive list, giving a frame
+   one more chance if it was accessed since the last sample, and
+   falls back to the active list only if there are no inactive
+   frames.
+
+   "2q" is the 2Q algorithm of Johnson and Shasha.  A page
+   brought in for the first time goes on the A1in FIFO, which is
+   allowed about a quarter of the frames.  Pages evicted from
+   A1in are remembered on the A1out "ghost" list, and a page
+   that faults again while still remembered goes on the Am list
+   instead, where it is kept in approximate LRU order.  Thus a
+   single scan through a large region of memory only ever
+   displaces the pages on A1in. */
+
+/* Removes and returns the first frame on LIST that is eligible,
+   can be locked, and has not been referenced since it was last
+   examined.  Referenced frames move to the back of LIST.  Makes
+   at most two passes, so that every referenced frame is
+   examined again after its reference is cleared.  Returns a
+   null pointer if no frame qualifies. */
+static struct frame *
+second_chance (struct list *list, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < 2 * cnt && !list_empty (list); i++)
+    {
+      struct frame *f = list_entry (list_pop_front (list),
+                                    struct frame, elem);
+      if (frame_eligible (f) && lock_try_acquire (&f->lock))
+        {
+          if (!frame_referenced (f))
+            return f;
+          lock_release (&f->lock);
+        }
+      list_push_back (list, &f->elem);
+    }
+  return NULL;
+}
+
+/* Clock. */
+
+static struct list clock_ring;
+static size_t clock_cnt;
+
+static void
+clock_init (size_t frame_cnt UNUSED)
+{
+  list_init (&clock_ring);
+}
+
+/* The hand is at the front of the ring, so a new frame goes in
+   just behind it. */
+static void
+clock_insert (struct frame *f)
+{
+  list_push_back (&clock_ring, &f->elem);
+  clock_cnt++;
+}
+
+static void
+clock_remove (struct frame *f)
+{
+  list_remove (&f->elem);
+  clock_cnt--;
+}
+
+static void
+clock_sample (struct frame *f UNUSED)
+{
+}
+
+static struct frame *
+clock_pick_victim (void)
+{
+  struct frame *f = second_chance (&clock_ring, clock_cnt);
+  if (f != NULL)
+    clock_cnt--;
+  return f;
+}
+
+static const struct frame_policy clock_policy =
+  {
+    "clock",
+    clock_init, clock_insert, clock_remove, clock_sample,
+    clock_pick_victim,
+  };
+
+/* Aging. */
+
+enum { AGING_ACTIVE, AGING_INACTIVE };
+
+static struct list aging_lists[2];
+static size_t aging_cnt[2];
+
+static void
+aging_init (size_t frame_cnt UNUSED)
+{
+  list_init (&aging_lists[AGING_ACTIVE]);
+  list_init (&aging_lists[AGING_INACTIVE]);
+}
+
+static void
+aging_insert (struct frame *f)
+{
+  f->queue = f->age != 0 ? AGING_ACTIVE : AGING_INACTIVE;
+  list_push_back (&aging_lists[f->queue], &f->elem);
+  aging_cnt[f->queue]++;
+}
+
+static void
+aging_remove (struct frame *f)
+{
+  list_remove (&f->elem);
+  aging_cnt[f->queue]--;
+}
+
+static void
+aging_sample (struct frame *f)
+{
+  if ((f->age != 0) != (f->queue == AGING_ACTIVE))
+    {
+      aging_remove (f);
+      aging_insert (f);
+    }
+}
+
+static struct frame *
+aging_pick_victim (void)
+{
+  int queue;
+
+  /* A frame given another chance goes to the back of its own
+     list rather than to the active list, so that the inactive
+     list still drains in the order frames went idle. */
+  for (queue = AGING_INACTIVE; queue >= AGING_ACTIVE; queue--)
+    {
+      struct frame *f = second_chance (&aging_lists[queue],
+                                       aging_cnt[queue]);
+      if (f != NULL)
+        {
+          aging_cnt[queue]--;
+          return f;
+        }
+    }
+  return NULL;
+}
+
+static const struct frame_policy aging_policy =
+  {
+    "aging",
+    aging_init, aging_insert, aging_remove, aging_sample,
+    aging_pick_victim,
+  };
+
+/* 2Q. */
+
+enum { TWOQ_A1IN, TWOQ_AM };
+
+static struct list twoq_lists[2];
+static size_t twoq_cnt[2];
+
+/* Target size of A1in and number of evictions remembered on
+   A1out, in frames. */
+static size_t twoq_kin, twoq_kout;
+
+/* Count of evictions from A1in.  A page evicted from A1in is
+   stamped with this count in its `ghost' member, so A1out is
+   just the pages whose stamp is within twoq_kout of it. */
+static unsigned twoq_clock = 1;
+
+static void
+twoq_init (size_t frame_cnt)
+{
+  list_init (&twoq_lists[TWOQ_A1IN]);
+  list_init (&twoq_lists[TWOQ_AM]);
+  twoq_kin = frame_cnt / 4 > 0 ? frame_cnt / 4 : 1;
+  twoq_kout = frame_cnt / 2 > 0 ? frame_cnt / 2 : 1;
+}
+
+static void
+twoq_insert (struct frame *f)
+{
+  struct page *p = f->page;
+
+  f->queue = (p->ghost != 0 && twoq_clock - p->ghost <= twoq_kout
+              ? TWOQ_AM : TWOQ_A1IN);
+  p->ghost = 0;
+  list_push_back (&twoq_lists[f->queue], &f->elem);
+  twoq_cnt[f->queue]++;
+}
+
+static void
+twoq_remove (struct frame *f)
+{
+  list_remove (&f->elem);
+  twoq_cnt[f->queue]--;
+}
+
+/* Keeps Am in approximate LRU order.  Accesses to pages on A1in
+   are ignored, since they are usually correlated with the
+   access that brought the page in. */
+static void
+twoq_sample (struct frame *f)
+{
+  if (f->queue == TWOQ_AM && (f->age & AGE_TOP) != 0)
+    {
+      list_remove (&f->elem);
+      list_push_back (&twoq_lists[TWOQ_AM], &f->elem);
+    }
+}
+
+/* Removes and returns the oldest eligible frame on A1in that can
+   be locked, or a null pointer if there is none. */
+static struct frame *
+twoq_pick_a1in (void)
+{
+  struct list *list = &twoq_lists[TWOQ_A1IN];
+  struct list_elem *e;
+
+  for (e = list_begin (list); e != list_end (list); e = list_next (e))
+    {
+      struct frame *f = list_entry (e, struct frame, elem);
+      if (frame_eligible (f) && lock_try_acquire (&f->lock))
+        {
+          twoq_remove (f);
+          f->page->ghost = twoq_clock++;
+          if (twoq_clock == 0)
+            twoq_clock = 1;
+          return f;
+        }
+    }
+  return NULL;
+}
+
+static struct frame *
+twoq_pick_victim (void)
+{
+  struct frame *f = NULL;
+
+  if (twoq_cnt[TWOQ_A1IN] > twoq_kin || twoq_cnt[TWOQ_AM] == 0)
+    f = twoq_pick_a1in ();
+  if (f == NULL)
+    {
+      f = second_chance (&twoq_lists[TWOQ_AM], twoq_cnt[TWOQ_AM]);
+      if (f != NULL)
+        twoq_cnt[TWOQ_AM]--;
+    }
+  if (f == NULL)
+    f = twoq_pick_a1in ();
+  return f;
+}
+
+static const struct frame_policy twoq_policy =
+  {
+    "2q",
+    twoq_init, twoq_insert, twoq_remove, twoq_sample,
+    twoq_pick_victim,
+  };
+
+/* All the policies. */
+static const struct frame_policy *const policies[] =
+  {
+    &clock_policy, &aging_policy, &twoq_policy,
+  };
+
+const struct frame_policy *frame_policy = &aging_policy;
+
+/* Selects the page replacement policy called NAME.
+   Returns true if successful, false if there is no such
+   policy. */
+bool
+frame_policy_select (const char *name)
+{
+  size_t i;
+
+  if (name == NULL)
+    return false;
+  for (i = 0; i < sizeof policies / sizeof *policies; i++)
+    if (!strcmp (name, policies[i]->name))
+      {
+        frame_policy = policies[i];
+        return true;
+      }
+  return false;
+}
@@ -0,0 +1,33 @@
+#ifndef VM_POLICY_H
+#define VM_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+
+/* A page replacement policy.
+
+   The frame table tells the policy about each frame that comes
+   into use or goes out of use, and asks it for a victim when
+   no frame is free.  Every function is called with the frame
+   table's scan_lock held. */
+struct frame_policy
+  {
+    const char *name;                   /* Name for -evict option. */
+    void (*init) (size_t frame_cnt);    /* Called once at startup. */
+    void (*insert) (struct frame *);    /* Frame now holds a page. */
+    void (*remove) (struct frame *);    /* Frame is being freed. */
+    void (*sample) (struct frame *);    /* Frame's age was updated. */
+
+    /* Returns a frame to evict, locked and already removed, or a
+       null pointer if every frame is locked. */
+    struct frame *(*pick_victim) (void);
+  };
+
+/* -evict: The page replacement policy in use. */
+extern const struct frame_policy *frame_policy;
+
+bool frame_policy_select (const char *name);
+
+#endif /* vm/policy.h */
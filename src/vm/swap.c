@@ -0,0 +1,143 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/zswap.h"
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap pages. */
+static struct bitmap *swap_bitmap;
+
+/* Protects swap_bitmap. */
+static struct lock swap_lock;
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A page's `sector' with this bit set gives its slot in the
+   compressed swap pool (see zswap.c) instead of a sector on the
+   swap device. */
+#define ZSWAP_BIT 0x80000000u
+
+/* Statistics. */
+static long long hit_cnt;       /* # of pages swapped in from zswap. */
+static long long miss_cnt;      /* # of pages swapped in from disk. */
+
+/* Sets up swap. */
+void
+swap_init (void)
+{
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("no swap device--swap disabled\n");
+      swap_bitmap = bitmap_create (0);
+    }
+  else
+    swap_bitmap = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  lock_init (&swap_lock);
+  zswap_init ();
+}
+
+/* Swaps in page P, which must have a locked frame (and be
+   swapped out). */
+void
+swap_in (struct page *p)
+{
+  uint8_t *kpage;
+  size_t i;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->sector != (block_sector_t) -1);
+
+  kpage = kmap (p->frame->paddr);
+  if (p->sector & ZSWAP_BIT)
+    {
+      zswap_load (p->sector & ~ZSWAP_BIT, kpage);
+      hit_cnt++;
+    }
+  else
+    {
+      miss_cnt++;
+      for (i = 0; i < PAGE_SECTORS; i++)
+        block_read (swap_device, p->sector + i, kpage + i * BLOCK_SECTOR_SIZE);
+    }
+  kunmap (kpage);
+  swap_free (p);
+}
+
+/* Swaps out page P, which must have a locked frame, to the
+   compressed swap pool if it will fit there, otherwise to the
+   swap device.
+   Returns true if successful, false if swap is full. */
+bool
+swap_out (struct page *p)
+{
+  uint8_t *kpage;
+  size_t slot;
+  size_t i;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  kpage = kmap (p->frame->paddr);
+  if (zswap_store (kpage, &slot))
+    {
+      kunmap (kpage);
+      p->sector = slot | ZSWAP_BIT;
+      return true;
+    }
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    {
+      kunmap (kpage);
+      return false;
+    }
+
+  p->sector = slot * PAGE_SECTORS;
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, p->sector + i, kpage + i * BLOCK_SECTOR_SIZE);
+  kunmap (kpage);
+  return true;
+}
+
+/* Releases the swap slot held by page P, if any. */
+void
+swap_free (struct page *p)
+{
+  if (p->sector == (block_sector_t) -1)
+    return;
+
+  if (p->sector & ZSWAP_BIT)
+    zswap_free (p->sector & ~ZSWAP_BIT);
+  else
+    {
+      lock_acquire (&swap_lock);
+      bitmap_reset (swap_bitmap, p->sector / PAGE_SECTORS);
+      lock_release (&swap_lock);
+    }
+  p->sector = (block_sector_t) -1;
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages read from compressed pool, %lld from disk\n",
+          hit_cnt, miss_cnt);
+  zswap_print_stats ();
+}
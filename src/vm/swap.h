@@ -0,0 +1,14 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+
+struct page;
+
+void swap_init (void);
+void swap_in (struct page *);
+bool swap_out (struct page *);
+void swap_free (struct page *);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
@@ -0,0 +1,146 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/vmalloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap.
+
+   When enabled with -zswap, a pool of zswap_pages pages of
+   kernel memory sits in front of the swap device.  A page being
+   swapped out is compressed with lz_compress() and, if the
+   result is no bigger than MAX_SIZE, stored in the pool as a
+   run of CHUNK_SIZE-byte chunks, the first two bytes of which
+   give the compressed size.  Only pages that do not compress
+   well, or that arrive while the pool is full, go to the swap
+   device. */
+
+/* Allocation unit within the pool. */
+#define CHUNK_SIZE 64
+
+/* Largest compressed page worth keeping. */
+#define MAX_SIZE (PGSIZE * 3 / 4)
+
+size_t zswap_pages;
+
+/* The pool, and its chunks in use. */
+static uint8_t *pool;
+static struct bitmap *used_chunks;
+
+/* Protects used_chunks and the compression scratch space. */
+static struct lock zswap_lock;
+static uint16_t lz_table[LZ_TABLE_SIZE];
+static uint8_t scratch[MAX_SIZE];
+
+/* Statistics. */
+static long long store_cnt;     /* # of pages stored. */
+static long long store_bytes;   /* Compressed bytes of pages stored. */
+static long long poor_cnt;      /* # of pages that compressed poorly. */
+static long long full_cnt;      /* # of pages turned away by a full pool. */
+
+/* Sets up the compressed swap pool, if it is enabled. */
+void
+zswap_init (void)
+{
+  lock_init (&zswap_lock);
+  if (zswap_pages == 0)
+    return;
+
+  /* The pool need not be physically contiguous.  Settle for a
+     smaller one if need be. */
+  while (zswap_pages > 0
+         && (pool = vmalloc (zswap_pages * PGSIZE, 0)) == NULL)
+    zswap_pages /= 2;
+  if (pool == NULL)
+    {
+      printf ("zswap: no memory for pool--compressed swap disabled\n");
+      return;
+    }
+
+  used_chunks = bitmap_create (zswap_pages * PGSIZE / CHUNK_SIZE);
+  if (used_chunks == NULL)
+    PANIC ("couldn't create zswap bitmap");
+}
+
+/* Tries to compress PAGE into the pool.  Returns true and sets
+   *SLOT to its location if successful, false if the pool is
+   disabled or full or PAGE does not compress well. */
+bool
+zswap_store (const void *page, size_t *slot)
+{
+  size_t size, chunks;
+  uint8_t *p;
+
+  if (pool == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  size = lz_compress (page, PGSIZE, scratch, MAX_SIZE, lz_table);
+  if (size == 0)
+    {
+      poor_cnt++;
+      lock_release (&zswap_lock);
+      return false;
+    }
+
+  chunks = DIV_ROUND_UP (sizeof (uint16_t) + size, CHUNK_SIZE);
+  *slot = bitmap_scan_and_flip (used_chunks, 0, chunks, false);
+  if (*slot == BITMAP_ERROR)
+    {
+      full_cnt++;
+      lock_release (&zswap_lock);
+      return false;
+    }
+
+  p = pool + *slot * CHUNK_SIZE;
+  *(uint16_t *) p = size;
+  memcpy (p + sizeof (uint16_t), scratch, size);
+  store_cnt++;
+  store_bytes += size;
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* Decompresses the page stored at SLOT into PAGE.  The slot
+   remains in use until zswap_free(). */
+void
+zswap_load (size_t slot, void *page)
+{
+  uint8_t *p = pool + slot * CHUNK_SIZE;
+
+  ASSERT (bitmap_test (used_chunks, slot));
+  if (!lz_decompress (p + sizeof (uint16_t), *(uint16_t *) p, page, PGSIZE))
+    PANIC ("zswap: corrupt page in slot %zu", slot);
+}
+
+/* Releases the chunks of the page stored at SLOT. */
+void
+zswap_free (size_t slot)
+{
+  size_t size = *(uint16_t *) (pool + slot * CHUNK_SIZE);
+  size_t chunks = DIV_ROUND_UP (sizeof (uint16_t) + size, CHUNK_SIZE);
+
+  lock_acquire (&zswap_lock);
+  bitmap_set_multiple (used_chunks, slot, chunks, false);
+  lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  long long ratio;
+
+  if (pool == NULL)
+    return;
+  ratio = store_cnt > 0 ? store_bytes * 100 / (store_cnt * PGSIZE) : 0;
+  printf ("Zswap: %lld pages stored at %lld%% of their size, "
+          "%lld compressed poorly, %lld turned away by a full pool\n",
+          store_cnt, ratio, poor_cnt, full_cnt);
+}
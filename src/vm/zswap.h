@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* -zswap: Pages of kernel memory for compressed swap, or 0 to
+   disable it. */
+extern size_t zswap_pages;
+
+void zswap_init (void);
+bool zswap_store (const void *page, size_t *slot);
+void zswap_load (size_t slot, void *page);
+void zswap_free (size_t slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */